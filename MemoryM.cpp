@@ -18,7 +18,36 @@
     #include <string.h>
     #include <stdarg.h>
     #include "darray.h"
+    #include "phash.h"
     #include "MemoryM.h"
+    #ifdef _MSC_VER
+        #include <io.h>
+        #define __writeFd _write
+    #else
+        #include <unistd.h>
+        #define __writeFd write
+    #endif
+    #if defined(MEMORYM_THREAD_LOCAL) || defined(MEMORYM_SHARED)
+        #include <thread>
+        #include <mutex>
+    #endif
+    #if defined(MEMORYM_SHARED)
+        #include <atomic>
+    #endif
+    #if MEMORYM_TIMELINE_SIZE > 0 && defined(_MSC_VER)
+        #include <windows.h>
+    #endif
+    #if defined(MEMORYM_HEAP_PROFILE)
+        #include <math.h>
+        #ifdef _MSC_VER
+            #include <windows.h>
+            #define __backtrace(stack, depth) CaptureStackBackTrace(0, (depth), (stack), NULL)
+        #else
+            #include <execinfo.h>
+            #include <cxxabi.h>
+            #define __backtrace(stack, depth) backtrace((stack), (depth))
+        #endif
+    #endif
 #endif
 
 /*
@@ -54,719 +83,5203 @@
 
 #endif // _MSC_VER
 
-// First a dynamic array of MemoryAllocation
+/*
+    Find first set, return the index of the lowest bit set, v must not be 0
+    Find last set, return the index of the highest bit set, v must not be 0
+*/
+#ifdef _MSC_VER
 
-DArray*             MemoryAllocation_New()                                              { return darray_init(); }
-void                MemoryAllocation_PushA(DArray *array, MemoryAllocation *s)          { darray_push(array, s); }
-MemoryAllocation*   MemoryAllocation_Pop(DArray *array)                                 { return (MemoryAllocation *)darray_pop(array); }
-MemoryAllocation*   MemoryAllocation_Get(DArray *array, int index)                      { return (MemoryAllocation *)darray_get(array, index); }
-void                MemoryAllocation_Set(DArray *array, int index, MemoryAllocation *s) { darray_set(array, index, s); }
-void                MemoryAllocation_Destructor(DArray *array)                          { darray_free(array); }
-int                 MemoryAllocation_GetLength(DArray *array)                           { return array->last; }
+    #include <intrin.h>
 
-void MemoryAllocation_FreeAllocation(MemoryAllocation *a) {  
+    inline int __findFirstSet(unsigned long long v) {
 
-    if (a->data != NULL) {
-        free(a->data);
-        a->data = NULL;
+        unsigned long i;
+        if (_BitScanForward(&i, (unsigned long)v))
+            return (int)i;
+        _BitScanForward(&i, (unsigned long)(v >> 32));
+        return (int)i + 32;
     }
-}
 
-MemoryAllocation * MemoryAllocation_NewInstance() {
+    inline int __findLastSet(unsigned long long v) {
 
-    return (MemoryAllocation*)malloc(sizeof(MemoryAllocation));
-}
+        unsigned long i;
+        if (_BitScanReverse(&i, (unsigned long)(v >> 32)))
+            return (int)i + 32;
+        _BitScanReverse(&i, (unsigned long)v);
+        return (int)i;
+    }
+#else
+    #define __findFirstSet(v) __builtin_ctzll(v)
+    #define __findLastSet(v) (63 - __builtin_clzll(v))
+#endif
+
+/*
+    Atomic pointer operations of the remote free queue
+*/
+#if defined(MEMORYM_THREAD_LOCAL)
+    #ifdef _MSC_VER
+
+        #include <windows.h>
+
+        #define __atomicLoadPointer(p) (*(p))
+        #define __atomicExchangePointer(p, v) InterlockedExchangePointer((PVOID volatile*)(p), (v))
+        #define __atomicCompareExchangePointer(p, expected, v) \
+            (InterlockedCompareExchangePointer((PVOID volatile*)(p), (v), (expected)) == (expected))
+        #define __atomicLock(p) while (InterlockedExchange((LONG volatile*)(p), 1) != 0) {}
+        #define __atomicUnlock(p) InterlockedExchange((LONG volatile*)(p), 0)
+    #else
+        #define __atomicLoadPointer(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+        #define __atomicExchangePointer(p, v) __atomic_exchange_n((p), (v), __ATOMIC_ACQUIRE)
+        template<typename T> inline bool __atomicCompareExchangePointer(T* volatile* p, T* expected, T* v) {
+            return __atomic_compare_exchange_n(p, &expected, v, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        }
+        #define __atomicLock(p) while (__atomic_exchange_n((p), 1, __ATOMIC_ACQUIRE) != 0) {}
+        #define __atomicUnlock(p) __atomic_store_n((p), 0, __ATOMIC_RELEASE)
+    #endif
+    // MemoryOwnerHeader.next of an allocation not queued
+    #define MEMORYM_OWNER_TAG(owner) ((MemoryOwnerHeader*)((size_t)(owner) ^ (size_t)0x5BD1E9955BD1E995ULL))
+#endif
+
+/*
+    Atomic counters of the call sites, updated by all the threads
+*/
+#if defined(MEMORYM_SITE_STATS) && (defined(MEMORYM_THREAD_LOCAL) || defined(MEMORYM_SHARED))
+    #ifdef _MSC_VER
+        #include <windows.h>
+        #define __atomicAdd(p, v) InterlockedExchangeAdd64((LONG64 volatile*)(p), (v))
+    #else
+        #define __atomicAdd(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+    #endif
+#else
+    #define __atomicAdd(p, v) (*(p) += (v))
+#endif
 
-MemoryAllocation* __getFirstFreeMemoryAllocation();
+// *** Pool allocator ***
+// memoryM_InitWithPool() gives a buffer used instead of malloc() for all the memory 
+// of MemoryM, the allocations and the registry. The buffer is managed by a two level
+// segregated fit allocator (TLSF). The free blocks are in lists by size class, the 
+// first level is the power of 2 of the size and the second level splits it in 
+// MEMORYM_POOL_SL_COUNT classes, with a bitmap of the non empty lists at each level.
+// An allocation finds its list with 2 find first set and a freed block is merged 
+// with its free neighbours, both in constant time. The pool is at the start of the 
+// buffer, each block has a header of 2 pointers and a block ends the buffer.
+
+#define MEMORYM_POOL_ALIGN       (2 * sizeof(void*)) // Alignment of the data and of the sizes
+#define MEMORYM_POOL_SL_LOG2     4
+#define MEMORYM_POOL_SL_COUNT    (1 << MEMORYM_POOL_SL_LOG2)
+#define MEMORYM_POOL_FL_SHIFT    (MEMORYM_POOL_SL_LOG2 + 4)
+#define MEMORYM_POOL_FL_MAX      30 // Blocks up to 2GB
+#define MEMORYM_POOL_FL_COUNT    (MEMORYM_POOL_FL_MAX - MEMORYM_POOL_FL_SHIFT + 2)
+#define MEMORYM_POOL_SMALL_BLOCK (1 << MEMORYM_POOL_FL_SHIFT) // Classes of the same width below
+#define MEMORYM_POOL_FREE        1 // Bits of MemoryPoolBlock.size
+#define MEMORYM_POOL_PREVIOUS_FREE 2
+#define MEMORYM_POOL_HEADER      (2 * sizeof(void*))
+
+typedef struct MemoryPoolBlock {
+
+    struct MemoryPoolBlock* previousPhysical; // Valid when the previous block is free
+    size_t size; // Byte of data after the header, with MEMORYM_POOL_FREE and MEMORYM_POOL_PREVIOUS_FREE
+    struct MemoryPoolBlock* nextFree;         // In the data of a free block
+    struct MemoryPoolBlock* previousFree;
+} MemoryPoolBlock;
+
+typedef struct {
+
+    unsigned int     firstLevel; // Bit fl set when secondLevel[fl] is not 0
+    unsigned int     secondLevel[MEMORYM_POOL_FL_COUNT];
+    MemoryPoolBlock* blocks[MEMORYM_POOL_FL_COUNT][MEMORYM_POOL_SL_COUNT];
+    size_t           size;      // Byte of data of the pool when empty
+    size_t           freeBytes; // Byte of data of the free blocks
+    int              failures;  // Allocations refused
+} MemoryPool;
+
+#if defined(MEMORYM_THREAD_LOCAL) || defined(MEMORYM_SHARED)
+    std::mutex __poolLock;
+    #define MEMORYM_POOL_LOCK() std::lock_guard<std::mutex> __poolGuard(__poolLock)
+#else
+    #define MEMORYM_POOL_LOCK()
+#endif
 
-void MemoryAllocation_Push(DArray *array, int size, void *data) {
+#define __poolBlockSize(block) ((block)->size & ~(size_t)3)
+#define __poolNextPhysical(block) ((MemoryPoolBlock*)((char*)(block) + MEMORYM_POOL_HEADER + __poolBlockSize(block)))
 
-    MemoryAllocation* ma = __getFirstFreeMemoryAllocation();
+//////////////////////////////////////////////////////////////////
+/// __poolMapping
+/// 
+/// Return in fl and sl the list of the free blocks of size byte
+void __poolMapping(size_t size, int* fl, int* sl) {
 
-    if (ma == NULL) { // We need a new allocation
-        ma       = MemoryAllocation_NewInstance();
-        ma->data = data;
-        ma->size = size;
-        MemoryAllocation_PushA(array, ma);
+    if (size < MEMORYM_POOL_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (int)size / (MEMORYM_POOL_SMALL_BLOCK / MEMORYM_POOL_SL_COUNT);
     }
     else {
-        ma->data = data;
-        ma->size = size;
+        int last = __findLastSet(size);
+        *sl      = (int)(size >> (last - MEMORYM_POOL_SL_LOG2)) ^ MEMORYM_POOL_SL_COUNT;
+        *fl      = last - MEMORYM_POOL_FL_SHIFT + 1;
     }
 }
+void __poolInsert(MemoryPool* pool, MemoryPoolBlock* block) {
+
+    int fl, sl;
+    __poolMapping(__poolBlockSize(block), &fl, &sl);
+    MemoryPoolBlock* head = pool->blocks[fl][sl];
+
+    block->nextFree       = head;
+    block->previousFree   = NULL;
+    if (head != NULL)
+        head->previousFree = block;
+    pool->blocks[fl][sl]  = block;
+    pool->firstLevel     |= 1u << fl;
+    pool->secondLevel[fl] |= 1u << sl;
+    pool->freeBytes      += __poolBlockSize(block);
+}
+void __poolRemove(MemoryPool* pool, MemoryPoolBlock* block) {
 
-// *** Single instance allocated *** 
-MemoryManager __localMemoryM; 
-
-// Internal pre allocated buffer used to
-// - Format date before being allocated by MemoryM
-static char __MemoryM__InternalBuffer[32];
+    int fl, sl;
+    __poolMapping(__poolBlockSize(block), &fl, &sl);
 
-// *** The methods of the singleton object ***
+    if (block->nextFree != NULL)
+        block->nextFree->previousFree = block->previousFree;
+    if (block->previousFree != NULL)
+        block->previousFree->nextFree = block->nextFree;
+    else {
+        pool->blocks[fl][sl] = block->nextFree;
+        if (block->nextFree == NULL) {
+            pool->secondLevel[fl] &= ~(1u << sl);
+            if (pool->secondLevel[fl] == 0)
+                pool->firstLevel &= ~(1u << fl);
+        }
+    }
+    pool->freeBytes -= __poolBlockSize(block);
+}
+//////////////////////////////////////////////////////////////////
+/// __poolTrim
+/// 
+/// Give back the end of the used block after size byte as a free block, 
+/// merged with the next block if it is free
+void __poolTrim(MemoryPool* pool, MemoryPoolBlock* block, size_t size) {
+
+    size_t blockSize = __poolBlockSize(block);
+    if (blockSize < size + MEMORYM_POOL_HEADER + MEMORYM_POOL_ALIGN)
+        return;
+
+    MemoryPoolBlock* rest = (MemoryPoolBlock*)((char*)block + MEMORYM_POOL_HEADER + size);
+    block->size           = size | (block->size & 3);
+    rest->size            = blockSize - size - MEMORYM_POOL_HEADER;
+
+    MemoryPoolBlock* next = __poolNextPhysical(rest);
+    if (next->size & MEMORYM_POOL_FREE) {
+        __poolRemove(pool, next);
+        rest->size += MEMORYM_POOL_HEADER + __poolBlockSize(next);
+        next        = __poolNextPhysical(rest);
+    }
+    rest->size            |= MEMORYM_POOL_FREE;
+    next->previousPhysical = rest;
+    next->size            |= MEMORYM_POOL_PREVIOUS_FREE;
+    __poolInsert(pool, rest);
+}
+//////////////////////////////////////////////////////////////////
+/// __poolAdjust
+/// 
+/// Return the size of the block for size byte, 0 if it is too big for the pool
+size_t __poolAdjust(size_t size) {
 
-int __getCount() {
+    if (size > ((size_t)1 << MEMORYM_POOL_FL_MAX))
+        return 0;
+    size = (size + MEMORYM_POOL_ALIGN - 1) & ~(MEMORYM_POOL_ALIGN - 1);
+    return size < MEMORYM_POOL_ALIGN ? MEMORYM_POOL_ALIGN : size;
+}
+void* __poolAlloc(MemoryPool* pool, size_t size) {
+
+    size = __poolAdjust(size);
+    if (size == 0)
+        return NULL;
+
+    size_t search = size; // Round up to the next class, any block of the list fits
+    if (search >= MEMORYM_POOL_SMALL_BLOCK)
+        search += ((size_t)1 << (__findLastSet(search) - MEMORYM_POOL_SL_LOG2)) - 1;
+    int fl, sl;
+    __poolMapping(search, &fl, &sl);
+
+    unsigned int secondLevel = pool->secondLevel[fl] & (~0u << sl);
+    if (secondLevel == 0) {
+        unsigned int firstLevel = fl + 1 < MEMORYM_POOL_FL_COUNT ? pool->firstLevel & (~0u << (fl + 1)) : 0;
+        if (firstLevel == 0)
+            return NULL;
+        fl          = __findFirstSet(firstLevel);
+        secondLevel = pool->secondLevel[fl];
+    }
+    MemoryPoolBlock* block = pool->blocks[fl][__findFirstSet(secondLevel)];
+    __poolRemove(pool, block);
 
-    return MemoryAllocation_GetLength(__localMemoryM._memoryAllocation);
+    block->size &= ~(size_t)MEMORYM_POOL_FREE;
+    __poolNextPhysical(block)->size &= ~(size_t)MEMORYM_POOL_PREVIOUS_FREE;
+    __poolTrim(pool, block, size);
+    return (char*)block + MEMORYM_POOL_HEADER;
 }
-MemoryAllocation* __getFirstFreeMemoryAllocation() {
+void __poolFree(MemoryPool* pool, void* data) {
 
-    int count = __getCount();
-    for (int i = 0; i <= count; i++) {
+    MemoryPoolBlock* block = (MemoryPoolBlock*)((char*)data - MEMORYM_POOL_HEADER);
 
-        MemoryAllocation * ma = MemoryAllocation_Get(__localMemoryM._memoryAllocation, i);
-        if (ma->data == NULL) {
-            return ma;
-        }
+    if (block->size & MEMORYM_POOL_PREVIOUS_FREE) {
+        MemoryPoolBlock* previous = block->previousPhysical;
+        __poolRemove(pool, previous);
+        previous->size += MEMORYM_POOL_HEADER + __poolBlockSize(block);
+        block           = previous;
     }
-    return NULL;
+    MemoryPoolBlock* next = __poolNextPhysical(block);
+    if (next->size & MEMORYM_POOL_FREE) {
+        __poolRemove(pool, next);
+        block->size += MEMORYM_POOL_HEADER + __poolBlockSize(next);
+        next         = __poolNextPhysical(block);
+    }
+    block->size           |= MEMORYM_POOL_FREE;
+    next->previousPhysical = block;
+    next->size            |= MEMORYM_POOL_PREVIOUS_FREE;
+    __poolInsert(pool, block);
 }
-MemoryAllocation* __getMemoryAllocation(void* data) {
-
-    int count = __getCount();
-    for (int i = 0; i <= count; i++) {
-
-        MemoryAllocation * ma = MemoryAllocation_Get(__localMemoryM._memoryAllocation, i);
-        if (ma->data == data) {
-            return ma;
-        }
+//////////////////////////////////////////////////////////////////
+/// __poolRealloc
+/// 
+/// Resize the block of data in place when it shrinks or the next block is free
+/// and big enough, else move it. Return NULL and keep data if there is no room
+void* __poolRealloc(MemoryPool* pool, void* data, size_t size) {
+
+    if (data == NULL)
+        return __poolAlloc(pool, size);
+
+    MemoryPoolBlock* block = (MemoryPoolBlock*)((char*)data - MEMORYM_POOL_HEADER);
+    size_t current         = __poolBlockSize(block);
+    size_t adjusted        = __poolAdjust(size);
+    if (adjusted == 0)
+        return NULL;
+
+    MemoryPoolBlock* next = __poolNextPhysical(block);
+    if (adjusted > current && (next->size & MEMORYM_POOL_FREE) && current + MEMORYM_POOL_HEADER + __poolBlockSize(next) >= adjusted) {
+        __poolRemove(pool, next);
+        block->size += MEMORYM_POOL_HEADER + __poolBlockSize(next);
+        __poolNextPhysical(block)->size &= ~(size_t)MEMORYM_POOL_PREVIOUS_FREE;
+        current = __poolBlockSize(block);
     }
-    return NULL;
+    if (adjusted <= current) {
+        __poolTrim(pool, block, adjusted);
+        return data;
+    }
+    void* d = __poolAlloc(pool, size);
+    if (d == NULL)
+        return NULL;
+    memcpy(d, data, current);
+    __poolFree(pool, data);
+    return d;
+}
+//////////////////////////////////////////////////////////////////
+/// __poolLargestFree
+/// 
+/// Return the size of the largest free block, from the highest non empty list
+size_t __poolLargestFree(MemoryPool* pool) {
+
+    if (pool->firstLevel == 0)
+        return 0;
+    int fl = __findLastSet(pool->firstLevel);
+    int sl = __findLastSet(pool->secondLevel[fl]);
+
+    size_t largest = 0;
+    for (MemoryPoolBlock* block = pool->blocks[fl][sl]; block != NULL; block = block->nextFree) {
+        if (__poolBlockSize(block) > largest)
+            largest = __poolBlockSize(block);
+    }
+    return largest;
+}
+//////////////////////////////////////////////////////////////////
+/// __poolInit
+/// 
+/// Create the pool at the start of buffer with one free block of the rest
+MemoryPool* __poolInit(void* buffer, size_t size) {
+
+    char* start = (char*)(((size_t)buffer + MEMORYM_POOL_ALIGN - 1) & ~(MEMORYM_POOL_ALIGN - 1));
+    char* first = start + ((sizeof(MemoryPool) + MEMORYM_POOL_ALIGN - 1) & ~(MEMORYM_POOL_ALIGN - 1));
+    char* end   = (char*)buffer + size;
+    if (end < first + 2 * MEMORYM_POOL_HEADER + MEMORYM_POOL_ALIGN)
+        return NULL;
+
+    MemoryPool* pool = (MemoryPool*)start;
+    memset(pool, 0, sizeof(MemoryPool));
+
+    size_t blockSize = (size_t)(end - first - 2 * MEMORYM_POOL_HEADER) & ~(MEMORYM_POOL_ALIGN - 1);
+    if (blockSize > ((size_t)1 << MEMORYM_POOL_FL_MAX))
+        blockSize = (size_t)1 << MEMORYM_POOL_FL_MAX;
+
+    MemoryPoolBlock* block = (MemoryPoolBlock*)first;
+    block->size            = blockSize | MEMORYM_POOL_FREE;
+    MemoryPoolBlock* last  = __poolNextPhysical(block); // Never free, the blocks before it always have a next block
+    last->size             = MEMORYM_POOL_PREVIOUS_FREE;
+    last->previousPhysical = block;
+    __poolInsert(pool, block);
+    pool->size = blockSize;
+    return pool;
 }
-void* __newAllocOnly(int size) {
 
-    void * d = malloc(size);
-    memset(d, 0, size);
-    return d;
+//////////////////////////////////////////////////////////////////
+/// __poolAllocAligned
+/// 
+/// Allocate size byte aligned on align, a power of 2. The block is allocated with
+/// room for the alignment and the free block before the aligned data is given back
+void* __poolAllocAligned(MemoryPool* pool, size_t size, size_t align) {
+
+    if (align <= MEMORYM_POOL_ALIGN)
+        return __poolAlloc(pool, size);
+
+    size_t adjusted = __poolAdjust(size);
+    size_t gapMin   = MEMORYM_POOL_HEADER + MEMORYM_POOL_ALIGN; // Smallest free block
+    if (adjusted == 0 || adjusted > ((size_t)1 << MEMORYM_POOL_FL_MAX) - align - gapMin)
+        return NULL;
+    char* d = (char*)__poolAlloc(pool, adjusted + align + gapMin);
+    if (d == NULL)
+        return NULL;
+
+    char* aligned = (char*)(((size_t)d + align - 1) & ~(align - 1));
+    size_t gap    = aligned - d;
+    if (gap != 0 && gap < gapMin) {
+        aligned += align;
+        gap     += align;
+    }
+    MemoryPoolBlock* block = (MemoryPoolBlock*)(d - MEMORYM_POOL_HEADER);
+    if (gap != 0) { // The previous block is used, the gap is not merged
+        size_t blockSize      = __poolBlockSize(block);
+        MemoryPoolBlock* used = (MemoryPoolBlock*)(aligned - MEMORYM_POOL_HEADER);
+        used->size            = (blockSize - gap) | MEMORYM_POOL_PREVIOUS_FREE;
+        used->previousPhysical = block;
+        block->size           = (gap - MEMORYM_POOL_HEADER) | MEMORYM_POOL_FREE;
+        __poolInsert(pool, block);
+        block                 = used;
+    }
+    __poolTrim(pool, block, adjusted);
+    return aligned;
 }
-void* __newAlloc(int size) {
+// *** Backend ***
+// All the memory of MemoryM comes from the MemoryBackend set by memoryM_InitWithBackend() 
+// before the first memoryM(), the C library by default. MemoryM knows the size of each 
+// block from the registry and gives it back on free and re allocation, so an allocator 
+// with sized deallocation skips the lookup of the size. The adapters are the C library, 
+// the C library with sized deallocation and the pool of memoryM_InitWithPool().
+
+void* __libcAlloc(void*, size_t size, size_t align) {
+
+    if (align <= MEMORYM_BACKEND_ALIGN)
+        return malloc(size);
+    #ifdef _MSC_VER
+        return _aligned_malloc(size, align);
+    #else
+        void* d;
+        return posix_memalign(&d, align, size) == 0 ? d : NULL;
+    #endif
+}
+void* __libcAllocZero(void*, size_t size) {
 
-    void * d = __newAllocOnly(size);
-    MemoryAllocation_Push(__localMemoryM._memoryAllocation, size, d);
-    return d;
+    return calloc(1, size);
 }
-bool* __newBool() {
+void* __libcRealloc(void*, void* data, size_t, size_t newSize) {
 
-    return (bool*)__newAlloc(sizeof(bool));
+    return realloc(data, newSize);
 }
-int* __newInt() {
+void __libcFree(void*, void* data, size_t, size_t align) {
 
-    return (int*)__newAlloc(sizeof(int));
+    #ifdef _MSC_VER
+        if (align > MEMORYM_BACKEND_ALIGN) {
+            _aligned_free(data);
+            return;
+        }
+    #else
+        (void)align; // free() releases the blocks of posix_memalign()
+    #endif
+    free(data);
 }
-char* __newStringLen(int size) {
 
-    return (char*)__newAlloc(size + 1);
+// Sized deallocation of jemalloc (sdallocx) or of C23 (free_sized, free_aligned_sized), 
+// resolved at link time, NULL when the C library does not have them
+#if defined(__GNUC__) && defined(__ELF__)
+    extern "C" void __sdallocx(void* data, size_t size, int flags) __asm__("sdallocx") __attribute__((weak));
+    extern "C" void __freeSized(void* data, size_t size) __asm__("free_sized") __attribute__((weak));
+    extern "C" void __freeAlignedSized(void* data, size_t align, size_t size) __asm__("free_aligned_sized") __attribute__((weak));
+#else
+    #define __sdallocx ((void(*)(void*, size_t, int))NULL)
+    #define __freeSized ((void(*)(void*, size_t))NULL)
+    #define __freeAlignedSized ((void(*)(void*, size_t, size_t))NULL)
+#endif
+
+// free_aligned_sized() requires aligned_alloc() and a size multiple of the alignment
+#define __sizedAlignedSize(size, align) (((size) + (align) - 1) & ~((align) - 1))
+
+void* __sizedAlloc(void* context, size_t size, size_t align) {
+
+    #if defined(__GNUC__) && defined(__ELF__)
+        if (align > MEMORYM_BACKEND_ALIGN)
+            return aligned_alloc(align, __sizedAlignedSize(size, align));
+    #endif
+    return __libcAlloc(context, size, align);
+}
+void __sizedFree(void* context, void* data, size_t size, size_t align) {
+
+    bool aligned = align > MEMORYM_BACKEND_ALIGN;
+    if (__sdallocx != NULL)
+        __sdallocx(data, aligned ? __sizedAlignedSize(size, align) : size, aligned ? __findFirstSet(align) : 0); // MALLOCX_LG_ALIGN()
+    else if (aligned && __freeAlignedSized != NULL)
+        __freeAlignedSized(data, align, __sizedAlignedSize(size, align));
+    else if (!aligned && __freeSized != NULL)
+        __freeSized(data, size);
+    else
+        __libcFree(context, data, size, align);
 }
-char* __newString(char *s) {
 
-    if (s == NULL)
-        return __newStringLen(0);
+// The pool, the allocations refused are counted
 
-    int size = strlen(s);
-    char * newS = __newStringLen(size);
-    strcpy(newS, s);
-    return newS;
+void* __poolBackendAlloc(void* context, size_t size, size_t align) {
+
+    MemoryPool* pool = (MemoryPool*)context;
+    MEMORYM_POOL_LOCK();
+    void* d = __poolAllocAligned(pool, size, align);
+    if (d == NULL)
+        pool->failures++;
+    return d;
 }
-char* __concatString(char* s, char* previousAllocation) {
+void* __poolBackendRealloc(void* context, void* data, size_t, size_t newSize) {
 
-    if (s == NULL) { // Support to concat NULL
-        return previousAllocation;
-    }
+    MemoryPool* pool = (MemoryPool*)context;
+    MEMORYM_POOL_LOCK();
+    void* d = __poolRealloc(pool, data, newSize);
+    if (d == NULL)
+        pool->failures++;
+    return d;
+}
+void __poolBackendFree(void* context, void* data, size_t, size_t) {
 
-    if (previousAllocation == NULL) {
-        return __newString(s);
-    }
-    else {
-        MemoryAllocation * ma = __getMemoryAllocation(previousAllocation);
-        if (ma == NULL) {
-            return NULL;
-        }
-        else {
+    MEMORYM_POOL_LOCK();
+    __poolFree((MemoryPool*)context, data);
+}
 
-            char * currentS = (char*)ma->data;
-            int currentSize = ma->size; // Already contain the extra char for \0
-            int newSize     = currentSize + strlen(s);
-            char * newS     = (char*)__newAllocOnly(newSize);
+MemoryBackend MemoryBackend_Libc() {
 
-            strcpy(newS, currentS);
-            strcat(newS, s);
+    MemoryBackend backend = { __libcAlloc, __libcAllocZero, __libcRealloc, __libcFree, NULL, false };
+    return backend;
+}
+MemoryBackend MemoryBackend_Sized() {
 
-            MemoryAllocation_FreeAllocation(ma);
+    MemoryBackend backend = { __sizedAlloc, __libcAllocZero, __libcRealloc, __sizedFree, NULL, false };
+    return backend;
+}
+MemoryBackend MemoryBackend_Pool(void* buffer, size_t size) {
 
-            ma->size = newSize;
-            ma->data = newS;
-            return newS;
-        }
+    MemoryBackend backend = { NULL, NULL, NULL, NULL, NULL, false };
+    MemoryPool* pool      = buffer == NULL || size < MEMORYM_POOL_MIN_SIZE ? NULL : __poolInit(buffer, size);
+    if (pool != NULL) {
+        MemoryBackend poolBackend = { __poolBackendAlloc, NULL, __poolBackendRealloc, __poolBackendFree, pool, true };
+        backend = poolBackend;
     }
+    return backend;
 }
-char* __reNewString(char *s, char* previousAllocation) {
 
-    if (previousAllocation == NULL) {
-        return __newString(s);
-    }
-    else {
-        MemoryAllocation * ma = __getMemoryAllocation(previousAllocation);
-        if (ma == NULL) {
-            return NULL;
-        }
-        else {
-            MemoryAllocation_FreeAllocation(ma);
-            int size    = strlen(s);
-            char * newS = (char*)__newAllocOnly(size+1);
-            strcpy(newS, s);
-            ma->size    = size+1;
-            ma->data    = newS;
-            return newS;
-        }
-    }
+MemoryBackend __backend = { __libcAlloc, __libcAllocZero, __libcRealloc, __libcFree, NULL, false };
+bool __backendReserve; // MemoryBackend.mayFail, the registry grows before the allocation
+
+MemoryPool* __backendPool() {
+
+    return __backend.Alloc == __poolBackendAlloc ? (MemoryPool*)__backend.context : NULL;
+}
+//////////////////////////////////////////////////////////////////
+/// __poolGetStats
+/// 
+/// Copy the counters of the pool in stats, 0 without pool
+void __poolGetStats(MemoryStats* stats) {
+
+    stats->poolSize          = 0;
+    stats->poolFree          = 0;
+    stats->poolLargestFree   = 0;
+    stats->poolFailures      = 0;
+    stats->poolFragmentation = 0;
+
+    MemoryPool* pool = __backendPool();
+    if (pool == NULL)
+        return;
+
+    MEMORYM_POOL_LOCK();
+    stats->poolSize        = pool->size;
+    stats->poolFree        = pool->freeBytes;
+    stats->poolLargestFree = __poolLargestFree(pool);
+    stats->poolFailures    = pool->failures;
+    if (stats->poolFree > 0)
+        stats->poolFragmentation = 1.0 - (double)stats->poolLargestFree / stats->poolFree;
 }
-bool __free(void* data) {
 
-    if (data == NULL) // Allow to free NULL pointer
-        return true;
+// The memory of MemoryM, with the alignment of malloc() except for the slab pages
 
-    MemoryAllocation* ma = __getMemoryAllocation(data);
-    if (ma == NULL)  {
-        return false;
-    }
-    else {
-        MemoryAllocation_FreeAllocation(ma);
-        return true;
-    }
+inline void* __sysAllocAligned(size_t size, size_t align) {
+
+    return __backend.Alloc(__backend.context, size, align);
 }
-int __freeMultiple(int n, ...) {
+inline void* __sysMalloc(size_t size) {
 
-    int error = 0;
-    va_list vl;
-    va_start(vl, n);
-    for (int i = 0; i<n; i++) {
-        void * a = va_arg(vl, void*);
-        if (a != NULL) {
-            bool r = __free(a);
-            if (!r)
-                error += 1;
-        }
-    }
-    va_end(vl);
-    return error;
+    return __backend.Alloc(__backend.context, size, MEMORYM_BACKEND_ALIGN);
 }
-void __freeAll() {
+void* __sysCalloc(size_t count, size_t size) {
 
-    // Free all registered memory allocation first
-    int count = __getCount();
-    for (int i = 0; i <= count; i++) {
+    if (__backend.AllocZero != NULL)
+        return __backend.AllocZero(__backend.context, count * size);
 
-        MemoryAllocation_FreeAllocation(MemoryAllocation_Get(__localMemoryM._memoryAllocation, i));
-    }
-    // Free the MemoryAllocation dynamic array
-    MemoryAllocation_Destructor(__localMemoryM._memoryAllocation);
+    void* d = __sysMalloc(count * size);
+    if (d != NULL)
+        memset(d, 0, count * size);
+    return d;
 }
 //////////////////////////////////////////////////////////////////
-/// __format
-/// Format and allocate a string following the sprintf format
-///     http://www.tutorialspoint.com/c_standard_library/c_function_sprintf.htm
+/// __sysRealloc
 /// 
-/// For now there is a limit for the formated string of 1k.
-/// Formating padding is not implemented yet.
-char * __format(char *format, ...) {
+/// Re allocate the block data of size byte to newSize byte, data may be NULL. 
+/// Return NULL and keep data if the memory is not available
+void* __sysRealloc(void* data, size_t size, size_t newSize) {
 
-    char * formated = __newStringLen(0);
-    char tmpBuf[16]; // temp buffer to format number
-    va_list argptr;
-    va_start(argptr, format);
+    if (data == NULL)
+        return __sysMalloc(newSize);
+    return __backend.Realloc(__backend.context, data, size, newSize);
+}
+inline void __sysFreeAligned(void* data, size_t size, size_t align) {
 
-    while(*format != '\0') {
+    if (data != NULL)
+        __backend.Free(__backend.context, data, size, align);
+}
+inline void __sysFree(void* data, size_t size) {
 
-        if (*format == '%') {
-            format++;
-            if (*format == '%') { // string
-                formated = __concatString("%", formated);
-            }
-            else if (*format == 's') { // string
-                char* s = va_arg(argptr, char *); 
-                formated = __concatString(s, formated);
-            }
-            else if (*format == 'c') { // character
-                char c = (char)va_arg(argptr, int);
-                snprintf(tmpBuf, sizeof(tmpBuf), "%c", c);
-                formated = __concatString(tmpBuf, formated);
-            }
-            else if (*format == 'd') { // integer
-                int d = va_arg(argptr, int);
-                snprintf(tmpBuf, sizeof(tmpBuf), "%d", d); 
-                formated = __concatString(tmpBuf, formated);
-            }
-            else if (*format == 'u') { // un signed integer
-                unsigned int ui = va_arg(argptr, unsigned int);
-                snprintf(tmpBuf, sizeof(tmpBuf), "%u", ui); 
-                formated = __concatString(tmpBuf, formated);
-            }
-            else if (*format == 'x') { // un signed integer hexa
-                unsigned int ui = va_arg(argptr, unsigned int);
-                snprintf(tmpBuf, sizeof(tmpBuf), "%x", ui); 
-                formated = __concatString(tmpBuf, formated);
-            }
-            else if (*format == 'X') { // un signed integer hexa uppercase
-                unsigned int ui = va_arg(argptr, unsigned int);
-                snprintf(tmpBuf, sizeof(tmpBuf), "%X", ui);
-                formated = __concatString(tmpBuf, formated);
-            }
-            else if (*format == 'f') { // float
-                double d = va_arg(argptr, double);
-                snprintf(tmpBuf, sizeof(tmpBuf), "%f", d); 
-                formated = __concatString(tmpBuf, formated);
-            }
-            else if (*format == 'b') { // boolean not standard
-                
-                //bool d = va_arg(argptr, bool);
-                int d = va_arg(argptr, int);
-                if (d)
-                    strcpy(tmpBuf, MEMORYM_TRUE);
-                else
-                    strcpy(tmpBuf, MEMORYM_FALSE);
-                formated = __concatString(tmpBuf, formated);
-            }
-        }
-        else {
-            char c = format[0];
-            snprintf(tmpBuf, sizeof(tmpBuf), "%c", c);
-            formated = __concatString(tmpBuf, formated);
-        }
-        format++;
-    }
-    va_end(argptr);
-    return formated;
+    __sysFreeAligned(data, size, MEMORYM_BACKEND_ALIGN);
 }
 
-char * __getReport() {
-    
-    int footerSize = 25 + 2;
-    int buffer2Len = 25 + 2;
-    char* tbuffer  = (char*)__newAllocOnly(buffer2Len + 1); // Temp buffer for the allocation
-    int   count    = __getCount();
-    char* buffer   = __newStringLen(0); // pre compute the size of the report
+// Bitmap of the available entries of the registry, the summary is after the bits 
+// in the same block
 
-    for (int i = 0; i <= count; i++) {
+void FreeSlotBitmap_Init(FreeSlotBitmap *b) {
 
-        MemoryAllocation * ma = MemoryAllocation_Get(__localMemoryM._memoryAllocation, i);
-        snprintf(tbuffer, buffer2Len, "[%3d] %5d - %X\r\n", i, ma->size, (unsigned int)ma->data);
-        buffer = __concatString(tbuffer, buffer);
-    }
-    // Remark: Format the footer in the tBuffer which has to be extended to 25 to be able to format the 
-    // the footer causing waste of memory when we format each entry above. We allocate a specific
-    // buffer just to format the footer
-    snprintf(tbuffer, buffer2Len, "Used:%5d, Count:%5d\r\n", memoryM()->GetMemoryUsed(), count);
-    buffer = __concatString(tbuffer, buffer);
-    free(tbuffer); // Free temp buffer
-    return buffer;
+    b->bits         = NULL;
+    b->summary      = NULL;
+    b->words        = 0;
+    b->firstSummary = 0;
 }
-int __getMemoryUsed() {
+#define FreeSlotBitmap_BlockSize(words) (((words) + ((words) + 63) / 64) * sizeof(unsigned long long))
 
-    int total = 0;
-    int count = __getCount();
-    for (int i = 0; i <= count; i++) {
+bool FreeSlotBitmap_Resize(FreeSlotBitmap *b, int words) {
 
-        MemoryAllocation* ma = MemoryAllocation_Get(__localMemoryM._memoryAllocation, i);
-        if (ma->data != NULL)
-            total += ma->size;
-    }
-    return total;
-}
-void __Initialize() {
+    int summaryWords    = (words + 63) / 64;
+    int oldSummaryWords = (b->words + 63) / 64;
 
-    __localMemoryM._memoryAllocation  = MemoryAllocation_New();
-    __localMemoryM._contextStackIndex = -1;
-    __localMemoryM.PushContext(); // Always save a context a 0
+    unsigned long long* bits = (unsigned long long*)__sysRealloc(b->bits, FreeSlotBitmap_BlockSize(b->words), FreeSlotBitmap_BlockSize(words));
+    if (bits == NULL)
+        return false;
+    memmove(bits + words, bits + b->words, oldSummaryWords * sizeof(unsigned long long)); // Before the new bits overwrite it
+    memset(bits + b->words, 0, (words - b->words) * sizeof(unsigned long long));
+    memset(bits + words + oldSummaryWords, 0, (summaryWords - oldSummaryWords) * sizeof(unsigned long long));
+    b->bits    = bits;
+    b->summary = bits + words;
+    b->words   = words;
+    return true;
 }
 //////////////////////////////////////////////////////////////////
-/// __PushContext
+/// FreeSlotBitmap_Reserve
 /// 
-/// Push in the stack the current state of the memory manager
-bool __PushContext() {
+/// Grow the bitmap once so the indexes lower than count are set without re allocation
+bool FreeSlotBitmap_Reserve(FreeSlotBitmap *b, int count) {
 
-    __localMemoryM._contextStackIndex++;
+    int word = (count - 1) >> 6;
 
-    if (__localMemoryM._contextStackIndex < MEMORYM_STACK_CONTEXT_SIZE) {
-        __localMemoryM._contextStack[__localMemoryM._contextStackIndex] = __getCount();
+    if (count <= 0 || word < b->words)
         return true;
+
+    int words = b->words == 0 ? 64 : b->words;
+    while (word >= words) {
+        words *= 2;
     }
-    else {
-        __localMemoryM._contextStackIndex--;
-        return false;
-    }
+    return FreeSlotBitmap_Resize(b, words);
 }
-//////////////////////////////////////////////////////////////////
-/// __PopContext
-/// 
-/// Restore the state of the memory manager based on the last push
-bool __PopContext() {
+void FreeSlotBitmap_Set(FreeSlotBitmap *b, int index) {
 
-    if (__localMemoryM._contextStackIndex > -1) {
+    int word = index >> 6;
 
-        int numberOfAllocToPop = __getCount() - __localMemoryM._contextStack[__localMemoryM._contextStackIndex];
-        __localMemoryM._contextStackIndex--;
+    if (!FreeSlotBitmap_Reserve(b, index + 1))
+        return; // The entry is not re used
+    b->bits[word]         |= 1ULL << (index & 63);
+    b->summary[word >> 6] |= 1ULL << (word & 63);
 
-        for(int i = 0; i < numberOfAllocToPop; i++) {
-            
-            MemoryAllocation* ma = MemoryAllocation_Pop(__localMemoryM._memoryAllocation); // Remove and return the allocation at the end of the array
-            MemoryAllocation_FreeAllocation(ma); // Free the allocation
+    if ((word >> 6) < b->firstSummary)
+        b->firstSummary = word >> 6;
+}
+void FreeSlotBitmap_Clear(FreeSlotBitmap *b, int index) {
+
+    int word = index >> 6;
+
+    if (word < b->words) {
+        b->bits[word] &= ~(1ULL << (index & 63));
+        if (b->bits[word] == 0) {
+            b->summary[word >> 6] &= ~(1ULL << (word & 63));
         }
-        return true;
     }
-    else 
-        return false;
 }
-struct tm * __newDate() {
+int FreeSlotBitmap_First(FreeSlotBitmap *b) {
 
-    time_t temp            = time(NULL);  // Get a tm structure -- not re entrant
-    struct tm * tick_time  = localtime(&temp);
-    struct tm * tick_time2 = (struct tm *)__newAlloc(sizeof(struct tm));
+    int summaryWords = (b->words + 63) / 64;
 
-    memcpy(tick_time2, tick_time, sizeof(struct tm));
-    return tick_time2;
-}
-struct tm * __reNewDate(struct tm * previousAllocation) {
-    if (previousAllocation == NULL) {
-        return __newDate();
-    }
-    else {
-        MemoryAllocation * ma = __getMemoryAllocation(previousAllocation);
-        if (ma == NULL) {
-            return NULL;
-        }
-        else {
-            MemoryAllocation_FreeAllocation(ma);
-            int size               = sizeof(struct tm);
-            struct tm * tick_time2 = (struct tm *)__newAllocOnly(size);
-            time_t temp            = time(NULL);  // Get a tm structure -- not re entrant
-            struct tm * tick_time  = localtime(&temp);
-            memcpy(tick_time2, tick_time, size);
-            ma->size               = size;
-            ma->data               = tick_time2;
-            return tick_time2;
+    while (b->firstSummary < summaryWords) {
+
+        unsigned long long s = b->summary[b->firstSummary];
+        if (s != 0) {
+            int word = (b->firstSummary << 6) + __findFirstSet(s);
+            return (word << 6) + __findFirstSet(b->bits[word]);
         }
+        b->firstSummary++;
     }
+    return -1;
 }
-struct tm * __newDateTime(int year, int month, int day, int hour, int minutes, int seconds) {
+void FreeSlotBitmap_Destructor(FreeSlotBitmap *b) {
 
-    struct tm * d = __newDate();
+    __sysFree(b->bits, FreeSlotBitmap_BlockSize(b->words));
+    FreeSlotBitmap_Init(b);
+}
 
-    d->tm_sec    = seconds;
-    d->tm_min    = minutes;
-    d->tm_hour   = hour;
-    d->tm_min    = minutes;
-    d->tm_mday   = day;
-    d->tm_mon    = month - 1;
-    d->tm_year   = year - 1900;
-    //d->tm_wday = ?;
-    //d->tm_yday = ?;
-    d->tm_isdst  = 0;
+// First a dynamic array of MemoryAllocation, stored as a structure of arrays. The arrays 
+// are in one block, in the order of __allocationArraySizes(), each of capacity entries
 
-    return d;
+//////////////////////////////////////////////////////////////////
+/// __allocationArraySizes
+/// 
+/// Set the size of one entry of each array in sizes, return the number of arrays
+int __allocationArraySizes(size_t* sizes) {
+
+    int n = 0;
+    sizes[n++] = sizeof(unsigned long long); // generation
+    sizes[n++] = sizeof(void*);              // data
+    sizes[n++] = sizeof(int);                // size
+    sizes[n++] = sizeof(int);                // allocated
+    sizes[n++] = sizeof(int);                // next
+    sizes[n++] = sizeof(int);                // previous
+    sizes[n++] = sizeof(int);                // references
+    #if defined(MEMORYM_SITE_STATS)
+        sizes[n++] = sizeof(int);            // site
+    #endif
+    #if defined(MEMORYM_HEAP_PROFILE)
+        sizes[n++] = sizeof(int);            // sample
+    #endif
+    return n;
 }
-char* __formatDateTime(struct tm *date, char* format) {
+size_t __allocationEntrySize() {
 
-    strftime(__MemoryM__InternalBuffer, sizeof(__MemoryM__InternalBuffer), format, date);
-    return __newString(__MemoryM__InternalBuffer);
+    size_t sizes[16];
+    size_t entry = 0;
+    int n        = __allocationArraySizes(sizes);
+    for (int i = 0; i < n; i++) {
+        entry += sizes[i];
+    }
+    return entry;
 }
-char* __reFormatDateTime(struct tm *date, char* format, char * previousAllocation) {
+//////////////////////////////////////////////////////////////////
+/// MemoryAllocation_Resize
+/// 
+/// Grow the arrays to capacity entries, the block is re allocated then each array 
+/// is moved to its new offset, the last first. Return false if the memory is not 
+/// available, the arrays are then unchanged
+bool MemoryAllocation_Resize(MemoryAllocationArray *array, int capacity) {
 
-    if (previousAllocation == NULL) {
-        return __formatDateTime(date, format);
+    size_t sizes[16];
+    int n        = __allocationArraySizes(sizes);
+    size_t entry = __allocationEntrySize();
+
+    char* block = (char*)__sysRealloc(array->generation, array->capacity * entry, capacity * entry);
+    if (block == NULL)
+        return false;
+
+    size_t offset = entry;
+    for (int i = n - 1; i >= 0; i--) {
+        offset -= sizes[i];
+        memmove(block + capacity * offset, block + array->capacity * offset, array->capacity * sizes[i]);
     }
-    else {
-        MemoryAllocation * ma = __getMemoryAllocation(previousAllocation);
-        if (ma == NULL) {
-            return NULL;
-        }
-        else {
-            MemoryAllocation_FreeAllocation(ma);
-            strftime(__MemoryM__InternalBuffer, sizeof(__MemoryM__InternalBuffer), format, date);
-            int size    = strlen(__MemoryM__InternalBuffer);
-            char * newS = (char*)__newAllocOnly(size + 1);
-            strcpy(newS, __MemoryM__InternalBuffer);
-            ma->size    = size + 1;
-            ma->data    = newS;
-            return newS;
-        }
+    array->generation = (unsigned long long*)block;
+    array->data       = (void**)(array->generation + capacity);
+    array->size       = (int*)(array->data + capacity);
+    array->allocated  = array->size + capacity;
+    array->next       = array->allocated + capacity;
+    array->previous   = array->next + capacity;
+    array->references = array->previous + capacity;
+    #if defined(MEMORYM_SITE_STATS) || defined(MEMORYM_HEAP_PROFILE)
+        int* optional = array->references + capacity;
+    #endif
+    #if defined(MEMORYM_SITE_STATS)
+        array->site   = optional;
+        optional     += capacity;
+    #endif
+    #if defined(MEMORYM_HEAP_PROFILE)
+        array->sample = optional;
+    #endif
+
+    for (int i = array->capacity; i < capacity; i++) {
+        array->data[i]       = NULL;
+        array->size[i]       = 0;
+        array->allocated[i]  = 0;
+        array->generation[i] = 0;
+        array->next[i]       = -1;
+        array->previous[i]   = -1;
+        array->references[i] = 0;
+        #if defined(MEMORYM_SITE_STATS)
+            array->site[i]   = -1;
+        #endif
+        #if defined(MEMORYM_HEAP_PROFILE)
+            array->sample[i] = -1;
+        #endif
     }
+    array->capacity = capacity;
+    return true;
 }
-#if !defined(WINFORMEBBLE)
+MemoryAllocationArray* MemoryAllocation_New() {
+
+    MemoryAllocationArray* array = (MemoryAllocationArray*)__sysCalloc(1, sizeof(MemoryAllocationArray));
+    if (array == NULL)
+        return NULL;
+    array->last = -1;
+    if (!MemoryAllocation_Resize(array, 16)) {
+        __sysFree(array, sizeof(MemoryAllocationArray));
+        return NULL;
+    }
+    return array;
+}
+//////////////////////////////////////////////////////////////////
+/// MemoryAllocation_Reserve
+/// 
+/// Grow the array once so count entries can be pushed without re allocation.
+/// Return false if the memory is not available
+bool MemoryAllocation_Reserve(MemoryAllocationArray *array, int count) {
 
-    void assertString(char *s1, char *s2) {
-        assert(!strcmp(s1, s2));
+    int capacity = array->capacity;
+    while (array->last + 1 + count > capacity) {
+        capacity *= 2;
     }
-    void assertDate(struct tm * date, int year, int month, int day, int hour, int minutes, int seconds) {
+    if (capacity != array->capacity) {
+        return MemoryAllocation_Resize(array, capacity);
+    }
+    return true;
+}
+bool MemoryAllocation_PushA(MemoryAllocationArray *array, MemoryAllocation *s) {
 
-        assert((year - 1900) == date->tm_year);
-        assert(month         == date->tm_mon + 1); // Month start a 0
+    return MemoryAllocation_Set(array, array->last + 1, s);
+}
+MemoryAllocation MemoryAllocation_Pop(MemoryAllocationArray *array) {
+
+    MemoryAllocation ma           = MemoryAllocation_Get(array, array->last);
+    array->data[array->last]      = NULL;
+    array->size[array->last]      = 0;
+    array->allocated[array->last] = 0;
+    array->generation[array->last] = 0;
+    array->references[array->last] = 0;
+    array->last--;
+    return ma;
+}
+MemoryAllocation MemoryAllocation_Get(MemoryAllocationArray *array, int index) {
+
+    MemoryAllocation ma;
+    ma.data = array->data[index];
+    ma.size = array->size[index];
+    return ma;
+}
+bool MemoryAllocation_Set(MemoryAllocationArray *array, int index, MemoryAllocation *s) {
+
+    if (index >= array->capacity) {
+        int capacity = array->capacity;
+        while (index >= capacity) {
+            capacity *= 2;
+        }
+        if (!MemoryAllocation_Resize(array, capacity)) // Nothing written out of the arrays
+            return false;
+    }
+    array->data[index]      = s->data;
+    array->size[index]      = s->size;
+    array->allocated[index] = s->size;
+
+    if (index > array->last) {
+        array->last = index;
+    }
+    return true;
+}
+void MemoryAllocation_Destructor(MemoryAllocationArray *array) {
+
+    __sysFree(array->generation, array->capacity * __allocationEntrySize());
+    __sysFree(array, sizeof(MemoryAllocationArray));
+}
+int MemoryAllocation_GetLength(MemoryAllocationArray *array) {
+
+    return array->last;
+}
+
+#if defined(MEMORYM_SHARED)
+
+// *** Shared instance, one registry per shard *** 
+// Each shard is a complete MemoryManager used behind its lock. __localMemoryM is the
+// shard locked by the current thread, so the code of the registry is the same in
+// all the modes. memoryM() returns __sharedMemoryM which combines the shards.
+// A new allocation is registered in the shard selected by the hash of its pointer.
+// A re allocation stays in the shard and the entry of the previous allocation, so 
+// it stays in its context. The header in front of a pointer is never read, the 
+// shard of a pointer is found in the indexes, so any pointer can be given.
+
+MemoryManager __sharedShards[MEMORYM_SHARD_COUNT];
+MemoryManager __sharedMemoryM;
+std::mutex    __sharedLocks[MEMORYM_SHARD_COUNT];
+thread_local MemoryManager* __shard = &__sharedShards[0];
+
+#define __localMemoryM (*__shard)
+
+int __sharedShardOfPointer(void* data) {
+
+    unsigned long long k = (unsigned long long)(size_t)data >> 4; // The low bits are 0 because of the alignment
+    return (int)((k * 0x9E3779B97F4A7C15ULL) >> 32) & (MEMORYM_SHARD_COUNT - 1);
+}
+// The allocations registered in another shard than the one of their pointer, re 
+// allocations which moved, are in the index _moved of the shard of their pointer 
+// with the shard of their entry, under the lock of the shard of the pointer. The 
+// lock of the entry is held when it is updated, so the second lock is taken in the 
+// order of the shards, else only if it is free. A missing or outdated entry only 
+// costs a search in all the shards, which also finds the pointers not managed.
+PHash*           __sharedMoved[MEMORYM_SHARD_COUNT];
+thread_local bool __sharedAllLocked = false; // By __sharedForEachShard()
+
+//////////////////////////////////////////////////////////////////
+/// __sharedSetMoved
+/// 
+/// Add data registered in the locked shard to the index _moved of the shard of 
+/// its pointer, or remove it when add is false
+void __sharedSetMoved(void* data, bool add) {
+
+    int shard        = (int)(__shard - __sharedShards);
+    int pointerShard = __sharedShardOfPointer(data);
+    if (shard == pointerShard || __sharedMoved[pointerShard] == NULL)
+        return;
+
+    bool lock = !__sharedAllLocked;
+    if (lock) {
+        if (pointerShard > shard)
+            __sharedLocks[pointerShard].lock();
+        else if (!__sharedLocks[pointerShard].try_lock())
+            return;
+    }
+    if (add)
+        phash_put(__sharedMoved[pointerShard], data, shard);
+    else
+        phash_remove(__sharedMoved[pointerShard], data);
+    if (lock)
+        __sharedLocks[pointerShard].unlock();
+}
+bool __sharedLockShardIfIndexed(int shard, void* data) {
+
+    __sharedLocks[shard].lock();
+    if (phash_get(__sharedShards[shard]._memoryIndex, data) != PHASH_NOT_FOUND)
+        return true;
+    __sharedLocks[shard].unlock();
+    return false;
+}
+//////////////////////////////////////////////////////////////////
+/// __sharedLockShardOf
+/// 
+/// Lock and return the shard where data is registered: the shard of the pointer, 
+/// the one given by its index _moved, else all the shards. Only the indexes are 
+/// read, data may not be managed by MemoryM. The shard of the pointer is locked 
+/// if no shard has data
+int __sharedLockShardOf(void* data) {
+
+    int first = __sharedShardOfPointer(data);
+    __sharedLocks[first].lock();
+    if (phash_get(__sharedShards[first]._memoryIndex, data) != PHASH_NOT_FOUND)
+        return first;
+    int moved = __sharedMoved[first] == NULL ? PHASH_NOT_FOUND : phash_get(__sharedMoved[first], data);
+    __sharedLocks[first].unlock();
+
+    if (moved != PHASH_NOT_FOUND && __sharedLockShardIfIndexed(moved, data))
+        return moved;
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+        if (shard != first && shard != moved && __sharedLockShardIfIndexed(shard, data))
+            return shard;
+    }
+    __sharedLocks[first].lock();
+    return first;
+}
+int __sharedShardOf(void* data) {
+
+    int shard = __sharedLockShardOf(data);
+    __sharedLocks[shard].unlock();
+    return shard;
+}
+//////////////////////////////////////////////////////////////////
+/// MemoryShardLock
+/// 
+/// Lock a shard and make it the __localMemoryM of the current thread 
+/// until the end of the scope
+struct MemoryShardLock {
+
+    int            shard;
+    MemoryManager* previous;
+
+    MemoryShardLock(int shard) : shard(shard), previous(__shard) {
+
+        __sharedLocks[shard].lock();
+        __shard = &__sharedShards[shard];
+    }
+    MemoryShardLock(void* data) : shard(__sharedLockShardOf(data)), previous(__shard) { // The shard of data
+
+        __shard = &__sharedShards[shard];
+    }
+    ~MemoryShardLock() {
+
+        __shard = previous;
+        __sharedLocks[shard].unlock();
+    }
+};
+#define MEMORYM_SHARD_LOCK(data) MemoryShardLock __shardLock((void*)(data))
+#define MEMORYM_SHARD_MOVED(data, add) __sharedSetMoved((data), (add))
+
+// The shards do not peak at the same time, the process wide counters and their peaks 
+// are kept in atomics updated with the counters of the shard
+std::atomic<int> __sharedMemoryUsed(0);
+std::atomic<int> __sharedLiveCount(0);
+std::atomic<int> __sharedPeakMemoryUsed(0);
+std::atomic<int> __sharedPeakLiveCount(0);
+std::atomic<int> __sharedContextUsed[MEMORYM_STATS_CONTEXT_COUNT];
+std::atomic<int> __sharedContextPeak[MEMORYM_STATS_CONTEXT_COUNT];
+
+void __sharedAtomicMax(std::atomic<int>* peak, int value) {
+
+    int current = peak->load(std::memory_order_relaxed);
+    while (value > current && !peak->compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+void __sharedCount(int context, int bytes, int count) {
+
+    __sharedAtomicMax(&__sharedPeakMemoryUsed, __sharedMemoryUsed.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    __sharedAtomicMax(&__sharedPeakLiveCount,  __sharedLiveCount.fetch_add(count, std::memory_order_relaxed) + count);
+    if (context >= 0 && context < MEMORYM_STATS_CONTEXT_COUNT)
+        __sharedAtomicMax(&__sharedContextPeak[context], __sharedContextUsed[context].fetch_add(bytes, std::memory_order_relaxed) + bytes);
+}
+
+//////////////////////////////////////////////////////////////////
+/// __sharedGroupByShard
+/// 
+/// Counting sort of n allocations by shard, shards[i] is the shard of the allocation i.
+/// The allocations of the shard s are order[firsts[s]] to order[firsts[s + 1] - 1]
+void __sharedGroupByShard(int* shards, int n, int* order, int* firsts) {
+
+    int next[MEMORYM_SHARD_COUNT];
+
+    memset(firsts, 0, (MEMORYM_SHARD_COUNT + 1) * sizeof(int));
+    for (int i = 0; i < n; i++)
+        firsts[shards[i] + 1]++;
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++)
+        firsts[shard + 1] += firsts[shard];
+
+    memcpy(next, firsts, sizeof(next));
+    for (int i = 0; i < n; i++)
+        order[next[shards[i]]++] = i;
+}
+
+#else
+
+// *** Single instance allocated, one per thread with MEMORYM_THREAD_LOCAL *** 
+MEMORYM_TLS MemoryManager __localMemoryM; 
+
+#define MEMORYM_SHARD_LOCK(data)
+#define MEMORYM_SHARD_MOVED(data, add)
+
+#endif
+
+#if defined(MEMORYM_THREAD_LOCAL)
+//////////////////////////////////////////////////////////////////
+/// MemoryIndexLock
+/// 
+/// Lock the index of a manager until the end of the scope. The owner thread only 
+/// takes it to change its index, the other threads to look a pointer up in it
+struct MemoryIndexLock {
+
+    volatile int* lock;
+
+    MemoryIndexLock(MemoryManager* manager) : lock(&manager->_indexLock) {
+
+        __atomicLock(lock);
+    }
+    ~MemoryIndexLock() {
+
+        __atomicUnlock(lock);
+    }
+};
+#define MEMORYM_INDEX_LOCK(manager) MemoryIndexLock __indexLock(manager)
+#else
+#define MEMORYM_INDEX_LOCK(manager)
+#endif
+
+void __indexPut(void* data, int index) {
+
+    MEMORYM_INDEX_LOCK(&__localMemoryM);
+    phash_put(__localMemoryM._memoryIndex, data, index);
+}
+void __indexRemove(void* data) {
+
+    MEMORYM_INDEX_LOCK(&__localMemoryM);
+    phash_remove(__localMemoryM._memoryIndex, data);
+}
+
+//////////////////////////////////////////////////////////////////
+/// __getContextOfGeneration
+/// 
+/// Return the level of the context of generation, -1 if it is not on the stack.
+/// The generations of the stack increase, most allocations belong to the top.
+int __getContextOfGeneration(unsigned long long generation) {
+
+    MemoryContext* stack = __localMemoryM._contextStack;
+    int top              = __localMemoryM._contextStackIndex;
+
+    if (top >= 0 && stack[top].generation == generation)
+        return top;
+
+    int low  = 0;
+    int high = top - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (stack[middle].generation == generation)
+            return middle;
+        if (stack[middle].generation < generation)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+    return -1;
+}
+//////////////////////////////////////////////////////////////////
+/// __getContextOfIndex
+/// 
+/// Return the context owning the entry at index, the context that will free it on Pop
+int __getContextOfIndex(int index) {
+
+    return __getContextOfGeneration(__localMemoryM._memoryAllocation->generation[index]);
+}
+//////////////////////////////////////////////////////////////////
+/// __contextLink
+/// 
+/// Add the entry at index to the list of entries of its context
+void __contextLink(int index) {
+
+    int context = __getContextOfIndex(index);
+    if (context == -1)
+        return;
+
+    MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+    MemoryContext* c             = &__localMemoryM._contextStack[context];
+
+    array->previous[index] = -1;
+    array->next[index]     = c->first;
+    if (c->first != -1)
+        array->previous[c->first] = index;
+    c->first = index;
+}
+void __contextUnlink(int index) {
+
+    int context = __getContextOfIndex(index);
+    if (context == -1)
+        return;
+
+    MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+    MemoryContext* c             = &__localMemoryM._contextStack[context];
+
+    if (array->previous[index] != -1)
+        array->next[array->previous[index]] = array->next[index];
+    else
+        c->first = array->next[index];
+    if (array->next[index] != -1)
+        array->previous[array->next[index]] = array->previous[index];
+}
+#if MEMORYM_TIMELINE_SIZE > 0
+//////////////////////////////////////////////////////////////////
+/// __timelineNow
+/// 
+/// Return the time of a monotonic clock in nanoseconds
+long long __timelineNow() {
+
+    #ifdef _MSC_VER
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (long long)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    #endif
+}
+//////////////////////////////////////////////////////////////////
+/// __timelineRecord
+/// 
+/// Write the live byte and count of now in the next slot of the timeline, 
+/// over the oldest sample when the ring is full
+void __timelineRecord() {
+
+    MemoryTimeline* timeline     = &__localMemoryM._timeline;
+    MemoryTimelineSample* sample = &timeline->samples[timeline->next];
+
+    sample->time       = __timelineNow();
+    sample->memoryUsed = __localMemoryM._memoryUsed;
+    sample->liveCount  = __localMemoryM._liveCount;
+    timeline->next     = (timeline->next + 1) % MEMORYM_TIMELINE_SIZE;
+    timeline->events   = MEMORYM_TIMELINE_PERIOD;
+    if (timeline->count < MEMORYM_TIMELINE_SIZE)
+        timeline->count++;
+}
+#define MEMORYM_TIMELINE_EVENT() if (--__localMemoryM._timeline.events <= 0) __timelineRecord()
+#else
+#define MEMORYM_TIMELINE_EVENT()
+#endif
+//////////////////////////////////////////////////////////////////
+/// __countContextAllocation
+/// 
+/// Update the running counters by bytes and count for an allocation added 
+/// (size, 1), removed (-size, -1) or resized (new size - size, 0) in context
+void __countContextAllocation(int context, int bytes, int count) {
+
+    #if defined(MEMORYM_SHARED)
+        __sharedCount(context, bytes, count);
+    #endif
+
+    __localMemoryM._memoryUsed += bytes;
+    __localMemoryM._liveCount  += count;
+
+    if (__localMemoryM._memoryUsed > __localMemoryM._peakMemoryUsed)
+        __localMemoryM._peakMemoryUsed = __localMemoryM._memoryUsed;
+    if (__localMemoryM._liveCount > __localMemoryM._peakLiveCount)
+        __localMemoryM._peakLiveCount = __localMemoryM._liveCount;
+
+    if (context >= 0) {
+        MemoryContext* c = &__localMemoryM._contextStack[context];
+        c->memoryUsed += bytes;
+        if (c->memoryUsed > c->peakMemoryUsed)
+            c->peakMemoryUsed = c->memoryUsed;
+    }
+    MEMORYM_TIMELINE_EVENT();
+}
+#if defined(MEMORYM_SITE_STATS)
+
+// *** Call site statistics ***
+// MemorySite_Enter() selects the site of the next allocations of the thread until 
+// MemorySite_Leave(), which restores the site of the enclosing MM_ macro. The 
+// registry keeps the site of each entry and the counters of the site follow the 
+// entry in __countAllocation(). The sites are found by file and line in a table 
+// shared by the threads, through a cache of the thread.
+
+MemorySite __sites[MEMORYM_SITE_COUNT];
+int        __sitesCount;
+
+#if defined(MEMORYM_THREAD_LOCAL) || defined(MEMORYM_SHARED)
+    std::mutex __sitesLock;
+    #define MEMORYM_SITES_LOCK() std::lock_guard<std::mutex> __sitesGuard(__sitesLock)
+    #define MEMORYM_SITE_TLS thread_local
+#else
+    #define MEMORYM_SITES_LOCK()
+    #define MEMORYM_SITE_TLS
+#endif
+
+#define MEMORYM_SITE_CACHE_SIZE 64
+#define MEMORYM_SITE_DEPTH      16 // Nested MM_ macros restoring their enclosing site
+
+typedef struct {
+
+    const char* file;
+    int         line;
+    int         site;
+} MemorySiteCacheEntry;
+
+static MEMORYM_SITE_TLS MemorySiteCacheEntry __siteCache[MEMORYM_SITE_CACHE_SIZE];
+static MEMORYM_SITE_TLS int                  __currentSite = -1;
+static MEMORYM_SITE_TLS int                  __siteStack[MEMORYM_SITE_DEPTH];
+static MEMORYM_SITE_TLS int                  __siteDepth;
+
+//////////////////////////////////////////////////////////////////
+/// __siteOf
+/// 
+/// Return the index in __sites of the site of file and line, added on the first
+/// call, -1 when the table is full. The same header included by several files 
+/// may have several __FILE__ pointers, the file is compared by content.
+int __siteOf(const char* file, int line, const char* function) {
+
+    MEMORYM_SITES_LOCK();
+    int mask = MEMORYM_SITE_COUNT - 1;
+    int i    = (int)(((unsigned int)line * 2654435761u) >> 8) & mask;
+
+    while (__sites[i].file != NULL) {
+        if (__sites[i].line == line && (__sites[i].file == file || strcmp(__sites[i].file, file) == 0))
+            return i;
+        i = (i + 1) & mask;
+    }
+    if ((__sitesCount + 1) * 4 > MEMORYM_SITE_COUNT * 3) // Keep empty slots to stop the probing
+        return -1;
+
+    __sites[i].file     = file;
+    __sites[i].function = function;
+    __sites[i].line     = line;
+    __sitesCount++;
+    return i;
+}
+void MemorySite_Enter(const char* file, int line, const char* function) {
+
+    MemorySiteCacheEntry* entry = &__siteCache[(line ^ ((size_t)file >> 4)) & (MEMORYM_SITE_CACHE_SIZE - 1)];
+    if (entry->file != file || entry->line != line) {
+        entry->file = file;
+        entry->line = line;
+        entry->site = __siteOf(file, line, function);
+    }
+    if (__siteDepth < MEMORYM_SITE_DEPTH)
+        __siteStack[__siteDepth] = __currentSite;
+    __siteDepth++;
+    __currentSite = entry->site;
+}
+void MemorySite_Leave() {
+
+    if (__siteDepth == 0) {
+        __currentSite = -1;
+        return;
+    }
+    __siteDepth--;
+    if (__siteDepth < MEMORYM_SITE_DEPTH) // Deeper the innermost site is kept
+        __currentSite = __siteStack[__siteDepth];
+}
+//////////////////////////////////////////////////////////////////
+/// __siteBucket
+/// 
+/// Return the bucket of the size histogram of size byte, 1-8 byte is 0, 9-16 is 1... 
+int __siteBucket(int size) {
+
+    int bucket = 0;
+    for (int s = (size - 1) >> 3; s > 0 && bucket < MEMORYM_SITE_HISTOGRAM - 1; s >>= 1) {
+        bucket++;
+    }
+    return bucket;
+}
+//////////////////////////////////////////////////////////////////
+/// __countSite
+/// 
+/// Update the counters of the site of the entry at index like __countAllocation(). 
+/// An entry added takes the current site, a re allocation keeps the site of the entry
+/// if there is no current site.
+void __countSite(int index, int bytes, int count) {
+
+    int* sites = __localMemoryM._memoryAllocation->site;
+    if (count > 0 && __currentSite != -1)
+        sites[index] = __currentSite;
+    if (sites[index] == -1)
+        return;
+
+    MemorySite* site = &__sites[sites[index]];
+    __atomicAdd(&site->liveBytes, bytes);
+    if (count > 0) {
+        __atomicAdd(&site->count, 1);
+        __atomicAdd(&site->bytes, bytes);
+        __atomicAdd(&site->histogram[__siteBucket(bytes)], 1);
+    }
+    else if (count < 0) {
+        __atomicAdd(&site->frees, 1);
+    }
+}
+
+#endif
+
+#if defined(MEMORYM_HEAP_PROFILE)
+
+// *** Heap profile ***
+// Each thread counts down the byte allocated until its next sample. The distance
+// between 2 samples follows an exponential distribution of mean __sampleRate, so
+// an allocation of size byte is sampled with the probability 1 - exp(-size / rate)
+// whatever the allocations before it. A sampled entry keeps its stack in __samples,
+// shared by the threads, until it is freed.
+
+typedef struct {
+
+    void* stack[MEMORYM_SAMPLE_DEPTH]; // Return addresses, the caller of __sampleAllocation() first
+    int   depth;
+    int   size; // Byte of the allocation when sampled, -1 when the sample is available
+    int   next; // Next available sample
+} MemorySample;
+
+MemorySample* __samples;
+int           __samplesCapacity;
+int           __samplesAvailable = -1;
+int           __samplesLive;
+int           __sampleRate = MEMORYM_SAMPLE_RATE;
+
+#if defined(MEMORYM_THREAD_LOCAL) || defined(MEMORYM_SHARED)
+    std::mutex __samplesLock;
+    #define MEMORYM_SAMPLES_LOCK() std::lock_guard<std::mutex> __samplesGuard(__samplesLock)
+    #define MEMORYM_SAMPLE_TLS thread_local
+#else
+    #define MEMORYM_SAMPLES_LOCK()
+    #define MEMORYM_SAMPLE_TLS
+#endif
+
+static MEMORYM_SAMPLE_TLS long long          __sampleCountdown; // Byte to allocate before the next sample
+static MEMORYM_SAMPLE_TLS unsigned long long __sampleRandom;    // State of the xorshift generator, 0 until the first draw
+
+//////////////////////////////////////////////////////////////////
+/// __sampleInterval
+/// 
+/// Draw the byte to allocate before the next sample of the thread
+long long __sampleInterval() {
+
+    if (__sampleRate <= 1)
+        return 0;
+    if (__sampleRandom == 0)
+        __sampleRandom = ((unsigned long long)(size_t)&__sampleRandom ^ (unsigned long long)time(NULL) << 20) | 1;
+
+    __sampleRandom ^= __sampleRandom << 13;
+    __sampleRandom ^= __sampleRandom >> 7;
+    __sampleRandom ^= __sampleRandom << 17;
+    double u = ((__sampleRandom >> 11) + 1) * (1.0 / 9007199254740992.0); // In ]0, 1]
+    return (long long)(-log(u) * __sampleRate);
+}
+//////////////////////////////////////////////////////////////////
+/// __sampleAllocation
+/// 
+/// Called when the entry at index of size byte exhausts the countdown of the thread.
+/// Record the stack of the entry and draw the next countdown. The countdown of a new
+/// thread starts at 0, its first allocation only draws it
+void __sampleAllocation(MemoryAllocationArray* array, int index, int size) {
+
+    bool first        = __sampleRandom == 0;
+    __sampleCountdown = __sampleInterval();
+    if (first && __sampleRate > 1)
+        return;
+
+    void* stack[MEMORYM_SAMPLE_DEPTH + 1];
+    int depth = __backtrace(stack, MEMORYM_SAMPLE_DEPTH + 1) - 1; // Without this frame
+    if (depth < 0)
+        depth = 0;
+
+    MEMORYM_SAMPLES_LOCK();
+    if (__samplesAvailable == -1) {
+        int capacity = __samplesCapacity == 0 ? 64 : __samplesCapacity * 2;
+        MemorySample* samples = (MemorySample*)__sysRealloc(__samples, __samplesCapacity * sizeof(MemorySample), capacity * sizeof(MemorySample));
+        if (samples == NULL)
+            return; // Not sampled
+        __samples    = samples;
+        for (int i = __samplesCapacity; i < capacity; i++) {
+            __samples[i].size = -1;
+            __samples[i].next = i + 1 < capacity ? i + 1 : -1;
+        }
+        __samplesAvailable = __samplesCapacity;
+        __samplesCapacity  = capacity;
+    }
+    int sample         = __samplesAvailable;
+    __samplesAvailable = __samples[sample].next;
+    memcpy(__samples[sample].stack, stack + 1, depth * sizeof(void*));
+    __samples[sample].depth = depth;
+    __samples[sample].size  = size;
+    __samplesLive++;
+    array->sample[index] = sample;
+}
+void __sampleFree(MemoryAllocationArray* array, int index) {
+
+    MEMORYM_SAMPLES_LOCK();
+    int sample = array->sample[index];
+    __samples[sample].size = -1;
+    __samples[sample].next = __samplesAvailable;
+    __samplesAvailable     = sample;
+    __samplesLive--;
+    array->sample[index] = -1;
+}
+int __setSampleRate(int bytes) {
+
+    int previous      = __sampleRate;
+    __sampleRate      = bytes < 1 ? 1 : bytes;
+    __sampleCountdown = __sampleInterval();
+    return previous;
+}
+// The only cost of an allocation not sampled
+#define MEMORYM_SAMPLE_NEW(array, index, size) \
+    if ((__sampleCountdown -= (size)) < 0) __sampleAllocation((array), (index), (size))
+#define MEMORYM_SAMPLE_FREE(array, index) \
+    if ((array)->sample[index] != -1) __sampleFree((array), (index))
+#else
+int __setSampleRate(int) {
+
+    return 0; // The sampling is compiled out without MEMORYM_HEAP_PROFILE
+}
+#define MEMORYM_SAMPLE_NEW(array, index, size)
+#define MEMORYM_SAMPLE_FREE(array, index)
+#endif
+
+void __countAllocation(int index, int bytes, int count) {
+
+    __countContextAllocation(__getContextOfIndex(index), bytes, count);
+    #if defined(MEMORYM_SITE_STATS)
+        __countSite(index, bytes, count);
+    #endif
+}
+
+// *** Slab allocator ***
+// Small allocations are packed in pages of slots of the same size class, the 
+// pages are aligned on a cache line. A freed slot is pushed on the free list 
+// of its class. The size of an allocation is always known by the registry, 
+// so the class of a slot is found from the size, without header.
+
+#if !defined(MEMORYM_NO_SLAB)
+
+    #define MEMORYM_CACHE_LINE 64
+
+    static int __slabClassSizes[MEMORYM_SLAB_CLASS_COUNT] = { 1, 4, 8, 16, 32, 64, sizeof(struct tm) };
+
+    //////////////////////////////////////////////////////////////////
+    /// __slabGetClass
+    /// 
+    /// Return the smallest class that can store size byte, -1 if size is too big 
+    int __slabGetClass(int size) {
+
+        int best = -1;
+        for (int c = 0; c < MEMORYM_SLAB_CLASS_COUNT; c++) {
+            if (__slabClassSizes[c] >= size && (best == -1 || __slabClassSizes[c] < __slabClassSizes[best])) {
+                best = c;
+            }
+        }
+        return best;
+    }
+    MemorySlabPage* __slabNewPage(MemorySlabClass* slabClass) {
+
+        char* slots           = (char*)__sysAllocAligned(MEMORYM_SLAB_PAGE_SIZE, MEMORYM_CACHE_LINE);
+        MemorySlabPage* page  = (MemorySlabPage*)__sysMalloc(sizeof(MemorySlabPage));
+        if (slots == NULL || page == NULL) {
+            __sysFreeAligned(slots, MEMORYM_SLAB_PAGE_SIZE, MEMORYM_CACHE_LINE);
+            __sysFree(page, sizeof(MemorySlabPage));
+            return NULL;
+        }
+        page->slots           = slots;
+        page->used            = 0;
+        page->previous        = slabClass->page;
+        slabClass->page       = page;
+        return page;
+    }
+    void* __slabAlloc(int c) {
+
+        MemorySlabClass* slabClass = &__localMemoryM._slabClasses[c];
+        int slotSize               = __slabClassSizes[c];
+
+        if (slabClass->freeCount > 0) {
+            return slabClass->freeSlots[--slabClass->freeCount];
+        }
+        MemorySlabPage* page = slabClass->page;
+        if (page == NULL || page->used + slotSize > MEMORYM_SLAB_PAGE_SIZE) {
+            page = __slabNewPage(slabClass);
+            if (page == NULL)
+                return NULL;
+        }
+        void* d     = page->slots + page->used;
+        page->used += slotSize;
+        return d;
+    }
+    void __slabFree(int c, void* d) {
+
+        MemorySlabClass* slabClass = &__localMemoryM._slabClasses[c];
+
+        if (slabClass->freeCount == slabClass->freeCapacity) {
+            int capacity     = slabClass->freeCapacity == 0 ? 64 : slabClass->freeCapacity * 2;
+            void** freeSlots = (void**)__sysRealloc(slabClass->freeSlots, slabClass->freeCapacity * sizeof(void*), capacity * sizeof(void*));
+            if (freeSlots == NULL)
+                return; // The slot is not re used until the page is released
+            slabClass->freeSlots    = freeSlots;
+            slabClass->freeCapacity = capacity;
+        }
+        slabClass->freeSlots[slabClass->freeCount++] = d;
+    }
+    void __slabDestructor() {
+
+        for (int c = 0; c < MEMORYM_SLAB_CLASS_COUNT; c++) {
+
+            MemorySlabClass* slabClass = &__localMemoryM._slabClasses[c];
+            while (slabClass->page != NULL) {
+                MemorySlabPage* previous = slabClass->page->previous;
+                __sysFreeAligned(slabClass->page->slots, MEMORYM_SLAB_PAGE_SIZE, MEMORYM_CACHE_LINE);
+                __sysFree(slabClass->page, sizeof(MemorySlabPage));
+                slabClass->page = previous;
+            }
+            __sysFree(slabClass->freeSlots, slabClass->freeCapacity * sizeof(void*));
+            memset(slabClass, 0, sizeof(MemorySlabClass));
+        }
+    }
+#endif
+
+//////////////////////////////////////////////////////////////////
+/// __allocOnlyClass
+/// 
+/// Return the slab class used to allocate size byte, -1 for malloc(). The slab 
+/// pages are never given back, so with a backend which may fail, as a pool, every 
+/// allocation comes from the backend and a freed block is available again at once
+int __allocOnlyClass(int size) {
+
+    #if !defined(MEMORYM_NO_SLAB)
+        if (__backendReserve)
+            return -1;
+        return __slabGetClass(size + MEMORYM_OWNER_SIZE);
+    #else
+        (void)size;
+        return -1;
+    #endif
+}
+//////////////////////////////////////////////////////////////////
+/// __allocOnlyCapacity
+/// 
+/// Return the number of byte really usable when allocating size byte
+int __allocOnlyCapacity(int size) {
+
+    #if !defined(MEMORYM_NO_SLAB)
+        int c = __allocOnlyClass(size);
+        if (c != -1)
+            return __slabClassSizes[c] - MEMORYM_OWNER_SIZE;
+    #endif
+    return size;
+}
+//////////////////////////////////////////////////////////////////
+/// __newAllocOnly
+/// 
+/// Allocate size byte without registering the allocation, set to 0 when zero 
+/// is true. A block not in a slab is zeroed by calloc(), which skips the pages 
+/// already zeroed by the OS. Must be freed with __freeAllocOnly() and the same 
+/// size or its capacity. Return NULL if the memory is not available.
+void* __newAllocOnly(int size, bool zero) {
+
+    void * d;
+    bool zeroed = false;
+    #if !defined(MEMORYM_NO_SLAB)
+        int c = __allocOnlyClass(size);
+        if (c != -1) {
+            d = __slabAlloc(c);
+        }
+        else
+    #endif
+    if (zero) {
+        d      = __sysCalloc(1, size + MEMORYM_OWNER_SIZE);
+        zeroed = true;
+    }
+    else {
+        d      = __sysMalloc(size + MEMORYM_OWNER_SIZE);
+    }
+    if (d == NULL)
+        return NULL;
+    #if defined(MEMORYM_OWNER_HEADER)
+        ((MemoryOwnerHeader*)d)->owner = &__localMemoryM;
+        ((MemoryOwnerHeader*)d)->next  = MEMORYM_OWNER_TAG(&__localMemoryM);
+        d = (char*)d + MEMORYM_OWNER_SIZE;
+    #endif
+    if (zero && !zeroed)
+        memset(d, 0, size);
+    return d;
+}
+void __freeAllocOnly(void* d, int size) {
+
+    d = (char*)d - MEMORYM_OWNER_SIZE;
+    #if !defined(MEMORYM_NO_SLAB)
+        int c = __allocOnlyClass(size);
+        if (c != -1) {
+            __slabFree(c, d);
+            return;
+        }
+    #endif
+    __sysFree(d, size + MEMORYM_OWNER_SIZE);
+}
+
+void __internRemove(int index);
+
+void MemoryAllocation_FreeAllocation(MemoryAllocationArray *array, int index) {  
+
+    void* data = array->data[index];
+
+    if (data != NULL) {
+        if (array->references[index] > 0) { // Whatever the number of references, the string does not exist anymore
+            __internRemove(index);
+            array->references[index] = 0;
+        }
+        __indexRemove(data);
+        MEMORYM_SHARD_MOVED(data, false);
+        FreeSlotBitmap_Set(&__localMemoryM._freeSlots, index);
+        __countAllocation(index, -array->size[index], -1);
+        MEMORYM_SAMPLE_FREE(array, index);
+        __contextUnlink(index); // The generation is kept, a re allocation stays in the context
+        __freeAllocOnly(data, array->allocated[index]);
+        array->data[index] = NULL;
+    }
+}
+
+int __getFirstFreeMemoryAllocation();
+
+bool MemoryAllocation_Push(MemoryAllocationArray *array, int size, void *data) {
+
+    return MemoryAllocation_PushAllocated(array, size, __allocOnlyCapacity(size), data);
+}
+//////////////////////////////////////////////////////////////////
+/// MemoryAllocation_PushGeneration
+/// 
+/// Register data in an available entry for the context of generation, 0 for no 
+/// context. Return the index of the entry, -1 when the entries cannot grow
+int MemoryAllocation_PushGeneration(MemoryAllocationArray *array, int size, int allocated, void *data, unsigned long long generation) {
+
+    int index = __getFirstFreeMemoryAllocation();
+
+    MemoryAllocation ma;
+    ma.data = data;
+    ma.size = size;
+    if (index == -1) { // We need a new entry
+        if (!MemoryAllocation_Set(array, array->last + 1, &ma))
+            return -1;
+        index = array->last;
+    }
+    else {
+        FreeSlotBitmap_Clear(&__localMemoryM._freeSlots, index);
+        MemoryAllocation_Set(array, index, &ma); // A free entry is in the arrays
+    }
+    array->allocated[index]  = allocated;
+    array->generation[index] = generation;
+    #if defined(MEMORYM_SITE_STATS)
+        array->site[index]   = -1; // Set by __countAllocation() from the current site
+    #endif
+    #if defined(MEMORYM_HEAP_PROFILE)
+        array->sample[index] = -1;
+    #endif
+
+    __indexPut(data, index);
+    MEMORYM_SHARD_MOVED(data, true); // An interned string re allocated is registered again in its shard
+    __countAllocation(index, size, 1);
+    MEMORYM_SAMPLE_NEW(array, index, size);
+    __contextLink(index);
+    return index;
+}
+bool MemoryAllocation_PushAllocated(MemoryAllocationArray *array, int size, int allocated, void *data) {
+
+    return MemoryAllocation_PushGeneration(array, size, allocated, data, __localMemoryM._contextStackIndex >= 0 ? 
+        __localMemoryM._contextStack[__localMemoryM._contextStackIndex].generation : 0) != -1;
+}
+
+// *** The methods of the singleton object ***
+
+int __getCount() {
+
+    return MemoryAllocation_GetLength(__localMemoryM._memoryAllocation);
+}
+int __getFirstFreeMemoryAllocation() {
+
+    return FreeSlotBitmap_First(&__localMemoryM._freeSlots);
+}
+int __getMemoryAllocationIndex(void* data) {
+
+    return phash_get(__localMemoryM._memoryIndex, data);
+}
+//////////////////////////////////////////////////////////////////
+/// __setMemoryAllocation
+/// 
+/// Re use the MemoryAllocation at index for a new data and re index it.
+/// The previous data must have been freed with MemoryAllocation_FreeAllocation()
+void __setMemoryAllocation(int index, int size, int allocated, void* data) {
+
+    __localMemoryM._memoryAllocation->size[index]      = size;
+    __localMemoryM._memoryAllocation->allocated[index] = allocated;
+    __localMemoryM._memoryAllocation->data[index]      = data;
+    __indexPut(data, index);
+    MEMORYM_SHARD_MOVED(data, true);
+    FreeSlotBitmap_Clear(&__localMemoryM._freeSlots, index);
+    __countAllocation(index, size, 1);
+    MEMORYM_SAMPLE_NEW(__localMemoryM._memoryAllocation, index, size);
+    __contextLink(index);
+}
+// *** Arena of a context ***
+// Allocations made in a context pushed with PushArenaContext() are bump allocated 
+// in chunks owned by the context and are not registered in _memoryAllocation. 
+// Each allocation is preceded by a MemoryArenaHeader. PopContext() releases the 
+// chunks without freeing each allocation.
+
+#define MEMORYM_ARENA_ALIGN(size) (((size) + 7) & ~7)
+#define MEMORYM_ARENA_CHUNK_DATA(chunk) ((char*)(chunk) + MEMORYM_ARENA_ALIGN(sizeof(MemoryArenaChunk)))
+#define MEMORYM_ARENA_HEADER_SIZE MEMORYM_ARENA_ALIGN(sizeof(MemoryArenaHeader) + MEMORYM_OWNER_SIZE)
+
+typedef struct {
+
+    int size;
+    int allocated; // Byte reserved for the allocation, greater or equal to size
+    int freed;
+} MemoryArenaHeader;
+
+MemoryArenaChunk* __arenaNewChunk(MemoryArena* arena, int size) {
+
+    int chunkSize = arena->chunk == NULL ? MEMORYM_ARENA_CHUNK_SIZE : arena->chunk->size * 2;
+    if (chunkSize > MEMORYM_ARENA_MAX_CHUNK_SIZE)
+        chunkSize = MEMORYM_ARENA_MAX_CHUNK_SIZE;
+    if (chunkSize < size)
+        chunkSize = size;
+
+    MemoryArenaChunk* chunk = (MemoryArenaChunk*)__sysMalloc(MEMORYM_ARENA_ALIGN(sizeof(MemoryArenaChunk)) + chunkSize);
+    if (chunk == NULL)
+        return NULL;
+    chunk->previous = arena->chunk;
+    chunk->size     = chunkSize;
+    chunk->used     = 0;
+    arena->chunk    = chunk;
+    return chunk;
+}
+void* __arenaAlloc(int context, int size, int allocated, bool zero) {
+
+    MemoryArena* arena      = &__localMemoryM._contextStack[context].arena;
+    int allocationSize      = MEMORYM_ARENA_HEADER_SIZE + MEMORYM_ARENA_ALIGN(allocated);
+    MemoryArenaChunk* chunk = arena->chunk;
+
+    if (chunk == NULL || chunk->size - chunk->used < allocationSize) {
+        chunk = __arenaNewChunk(arena, allocationSize);
+        if (chunk == NULL)
+            return NULL;
+    }
+
+    MemoryArenaHeader* header = (MemoryArenaHeader*)(MEMORYM_ARENA_CHUNK_DATA(chunk) + chunk->used);
+    header->size      = size;
+    header->allocated = MEMORYM_ARENA_ALIGN(allocated);
+    header->freed     = false;
+    chunk->used      += allocationSize;
+    arena->liveCount += 1;
+    arena->memoryUsed += size;
+
+    void* d = (char*)header + MEMORYM_ARENA_HEADER_SIZE;
+    #if defined(MEMORYM_OWNER_HEADER)
+        ((MemoryOwnerHeader*)((char*)d - MEMORYM_OWNER_SIZE))->owner = &__localMemoryM;
+        ((MemoryOwnerHeader*)((char*)d - MEMORYM_OWNER_SIZE))->next  = MEMORYM_OWNER_TAG(&__localMemoryM);
+    #endif
+    if (zero)
+        memset(d, 0, allocated);
+    __countContextAllocation(context, size, 1);
+    return d;
+}
+//////////////////////////////////////////////////////////////////
+/// __getArenaContextOf
+/// 
+/// Return the context of the arena containing data, -1 if data was not
+/// allocated in an arena
+int __getArenaContextOf(void* data) {
+
+    for (int context = __localMemoryM._contextStackIndex; context >= 0; context--) {
+
+        if (__localMemoryM._contextStack[context].arena.enabled) {
+
+            MemoryArenaChunk* chunk = __localMemoryM._contextStack[context].arena.chunk;
+            while (chunk != NULL) {
+
+                char* start = MEMORYM_ARENA_CHUNK_DATA(chunk);
+                if ((char*)data > start && (char*)data < start + chunk->used) {
+                    return context;
+                }
+                chunk = chunk->previous;
+            }
+        }
+    }
+    return -1;
+}
+MemoryArenaHeader* __arenaGetHeader(void* data) {
+
+    return (MemoryArenaHeader*)((char*)data - MEMORYM_ARENA_HEADER_SIZE);
+}
+bool __arenaFree(int context, void* data) {
+
+    MemoryArenaHeader* header = __arenaGetHeader(data);
+    if (header->freed) {
+        return false;
+    }
+    MemoryArena* arena = &__localMemoryM._contextStack[context].arena;
+    header->freed      = true;
+    arena->liveCount  -= 1;
+    arena->memoryUsed -= header->size;
+    __countContextAllocation(context, -header->size, -1);
+
+    // If this is the last allocation of the current chunk, give back the memory
+    MemoryArenaChunk* chunk = arena->chunk;
+    int allocationSize      = MEMORYM_ARENA_HEADER_SIZE + header->allocated;
+    if ((char*)header + allocationSize == MEMORYM_ARENA_CHUNK_DATA(chunk) + chunk->used) {
+        chunk->used -= allocationSize;
+    }
+    return true;
+}
+//////////////////////////////////////////////////////////////////
+/// __arenaRelease
+/// 
+/// Release all the chunks of the arena of the context and remove the allocations 
+/// still alive from the counters
+void __arenaRelease(int context) {
+
+    MemoryArena* arena = &__localMemoryM._contextStack[context].arena;
+
+    __localMemoryM._memoryUsed                 -= arena->memoryUsed;
+    __localMemoryM._liveCount                  -= arena->liveCount;
+    __localMemoryM._contextStack[context].memoryUsed -= arena->memoryUsed;
+
+    while (arena->chunk != NULL) {
+        MemoryArenaChunk* previous = arena->chunk->previous;
+        __sysFree(arena->chunk, MEMORYM_ARENA_ALIGN(sizeof(MemoryArenaChunk)) + arena->chunk->size);
+        arena->chunk = previous;
+    }
+    arena->enabled    = false;
+    arena->liveCount  = 0;
+    arena->memoryUsed = 0;
+    #if MEMORYM_TIMELINE_SIZE > 0
+        __timelineRecord(); // The drop of the whole arena is always in the timeline
+    #endif
+}
+
+// *** Remote free queue *** 
+// With MEMORYM_THREAD_LOCAL a thread freeing an allocation of another thread
+// pushes it in the queue of the owner, a lock free stack with many producers 
+// and one consumer. The owner takes the whole stack at once, so there is no ABA.
+
+#if defined(MEMORYM_THREAD_LOCAL)
+    void __drainRemoteFree();
+    #define MEMORYM_DRAIN_REMOTE_FREE() \
+        if (__atomicLoadPointer(&__localMemoryM._remoteFree) != NULL) __drainRemoteFree()
+
+    void __remoteFreePush(MemoryOwnerHeader* header) {
+
+        MemoryManager* owner = (MemoryManager*)header->owner;
+        MemoryOwnerHeader* head;
+        do {
+            head         = __atomicLoadPointer(&owner->_remoteFree);
+            header->next = head;
+        } while (!__atomicCompareExchangePointer(&owner->_remoteFree, head, header));
+    }
+
+    // The managers of the threads are linked in the registry from their initialization 
+    // to their FreeAll(). A pointer not in the index of the current thread is looked up 
+    // in the indexes of the others, so the header in front of it is only read once a 
+    // manager owns it.
+    std::mutex     __managersLock;
+    MemoryManager* __managers = NULL;
+
+    void __registerManager() {
+
+        std::lock_guard<std::mutex> guard(__managersLock);
+        __localMemoryM._nextManager = __managers;
+        __managers                  = &__localMemoryM;
+    }
+    void __unregisterManager() {
+
+        std::lock_guard<std::mutex> guard(__managersLock);
+        MemoryManager** manager = &__managers;
+        while (*manager != NULL && *manager != &__localMemoryM) {
+            manager = (MemoryManager**)&(*manager)->_nextManager;
+        }
+        if (*manager != NULL)
+            *manager = (MemoryManager*)__localMemoryM._nextManager;
+    }
+    //////////////////////////////////////////////////////////////////
+    /// __remoteFree
+    /// 
+    /// Queue data to the manager of another thread owning it. Return false if no 
+    /// manager owns it or if it is already queued
+    bool __remoteFree(void* data) {
+
+        std::lock_guard<std::mutex> guard(__managersLock);
+        for (MemoryManager* manager = __managers; manager != NULL; manager = (MemoryManager*)manager->_nextManager) {
+
+            if (manager == &__localMemoryM)
+                continue;
+            int index;
+            {
+                MEMORYM_INDEX_LOCK(manager);
+                index = phash_get(manager->_memoryIndex, data);
+            }
+            if (index != PHASH_NOT_FOUND) {
+                MemoryOwnerHeader* header = (MemoryOwnerHeader*)((char*)data - MEMORYM_OWNER_SIZE);
+                if (header->next != MEMORYM_OWNER_TAG(manager)) // Already queued
+                    return false;
+                __remoteFreePush(header);
+                return true;
+            }
+        }
+        return false;
+    }
+#else
+    #define MEMORYM_DRAIN_REMOTE_FREE()
+#endif
+
+//////////////////////////////////////////////////////////////////
+/// __reserveAllocations
+/// 
+/// Grow the registry, its index and the bitmap of its available entries once 
+/// so count allocations can be registered. The available entries, every entry 
+/// up to last not in the index, are used first. Return false if the memory is 
+/// not available
+bool __reserveAllocations(int count) {
+
+    MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+    int available                = array->last + 1 - __localMemoryM._memoryIndex->count;
+    if (!MemoryAllocation_Reserve(array, available < count ? count - available : 0) ||
+        !FreeSlotBitmap_Reserve(&__localMemoryM._freeSlots, array->capacity))
+        return false;
+    MEMORYM_INDEX_LOCK(&__localMemoryM);
+    return phash_reserve(__localMemoryM._memoryIndex, __localMemoryM._memoryIndex->count + count);
+}
+//////////////////////////////////////////////////////////////////
+/// __canRegister
+/// 
+/// With a backend which may fail the registry grows before the allocation, so an 
+/// exhausted pool fails the allocation and never the registration of an allocation done
+inline bool __canRegister(int count) {
+
+    return !__backendReserve || __reserveAllocations(count);
+}
+//////////////////////////////////////////////////////////////////
+/// __newAllocCapacity
+/// 
+/// Allocate and register size byte, with the capacity to grow up to allocated 
+/// byte without re allocation. The capacity is set to 0 when zero is true, else 
+/// the caller must write the content. Return NULL if the memory is not available
+void* __newAllocCapacity(int size, int allocated, bool zero) {
+
+    MEMORYM_DRAIN_REMOTE_FREE();
+    #if defined(MEMORYM_SHARED) // The pointer selects the shard, no arena
+        void * shared = __newAllocOnly(allocated, zero);
+        if (shared == NULL)
+            return NULL;
+        MemoryShardLock lock(__sharedShardOfPointer(shared));
+        if (!__canRegister(1)) {
+            __freeAllocOnly(shared, allocated);
+            return NULL;
+        }
+        if (!MemoryAllocation_PushAllocated(__localMemoryM._memoryAllocation, size, __allocOnlyCapacity(allocated), shared)) {
+            __freeAllocOnly(shared, allocated);
+            return NULL;
+        }
+        return shared;
+    #endif
+    int context = __localMemoryM._contextStackIndex;
+    if (context >= 0 && __localMemoryM._contextStack[context].arena.enabled) {
+        return __arenaAlloc(context, size, allocated, zero);
+    }
+    if (!__canRegister(1))
+        return NULL;
+    void * d = __newAllocOnly(allocated, zero);
+    if (d == NULL)
+        return NULL;
+    if (!MemoryAllocation_PushAllocated(__localMemoryM._memoryAllocation, size, __allocOnlyCapacity(allocated), d)) {
+        __freeAllocOnly(d, allocated);
+        return NULL;
+    }
+    return d;
+}
+void* __newAlloc(int size) {
+
+    return __newAllocCapacity(size, size, true);
+}
+bool __freeLocal(void* data);
+bool __free(void* data);
+
+//////////////////////////////////////////////////////////////////
+/// __newMany
+/// 
+/// Allocate and register n allocations of sizes[i] byte set to 0 in out[i],
+/// growing the registry once for the whole batch. Return out, NULL with nothing
+/// allocated if the memory is not available
+void** __newMany(int* sizes, int n, void** out) {
+
+    if (n <= 0)
+        return out;
+
+    MEMORYM_DRAIN_REMOTE_FREE();
+    #if defined(MEMORYM_SHARED) // Allocate all, then register the allocations of each shard under one lock
+        int  buffer[2 * 32]; // Small batches like the ones of FreeMultiple() are grouped on the stack
+        int* shards = n <= 32 ? buffer : (int*)__sysMalloc(2 * n * sizeof(int));
+        int* order  = shards + n;
+        int  firsts[MEMORYM_SHARD_COUNT + 1];
+
+        if (shards == NULL)
+            return NULL;
+        int allocatedCount = 0;
+        for (int i = 0; i < n; i++, allocatedCount++) {
+            out[i]    = __newAllocOnly(sizes[i], true);
+            if (out[i] == NULL)
+                break;
+            shards[i] = __sharedShardOfPointer(out[i]);
+        }
+        int failedShard = allocatedCount < n ? -1 : MEMORYM_SHARD_COUNT;
+        if (failedShard != -1) {
+            __sharedGroupByShard(shards, n, order, firsts);
+
+            for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+                if (firsts[shard] == firsts[shard + 1])
+                    continue;
+
+                MemoryShardLock lock(shard);
+                if (!__reserveAllocations(firsts[shard + 1] - firsts[shard])) {
+                    failedShard = shard;
+                    break;
+                }
+                for (int o = firsts[shard]; o < firsts[shard + 1]; o++) { // The entries are reserved, no failure
+                    MemoryAllocation_Push(__localMemoryM._memoryAllocation, sizes[order[o]], out[order[o]]);
+                }
+            }
+        }
+        if (failedShard != MEMORYM_SHARD_COUNT) { // Release the allocations, registered in the shards before the failed one
+            for (int i = 0; i < allocatedCount; i++) {
+                if (failedShard != -1 && shards[i] < failedShard)
+                    __free(out[i]);
+                else
+                    __freeAllocOnly(out[i], sizes[i]);
+            }
+        }
+        if (shards != buffer)
+            __sysFree(shards, 2 * n * sizeof(int));
+        return failedShard == MEMORYM_SHARD_COUNT ? out : NULL;
+    #endif
+    int context = __localMemoryM._contextStackIndex;
+    if (context >= 0 && __localMemoryM._contextStack[context].arena.enabled) {
+        for (int i = 0; i < n; i++) {
+            out[i] = __arenaAlloc(context, sizes[i], sizes[i], true);
+            if (out[i] == NULL) {
+                while (--i >= 0) {
+                    __arenaFree(context, out[i]);
+                }
+                return NULL;
+            }
+        }
+        return out;
+    }
+    if (!__reserveAllocations(n))
+        return NULL;
+    for (int i = 0; i < n; i++) {
+        out[i] = __newAllocOnly(sizes[i], true);
+        if (out[i] == NULL) {
+            while (--i >= 0) {
+                __freeLocal(out[i]);
+            }
+            return NULL;
+        }
+        MemoryAllocation_Push(__localMemoryM._memoryAllocation, sizes[i], out[i]); // Reserved, no failure
+    }
+    return out;
+}
+//////////////////////////////////////////////////////////////////
+/// __getAllocationSize
+/// 
+/// Return the size of an allocation managed by MemoryM, -1 if the data is not managed
+int __getAllocationSize(void* data) {
+
+    MEMORYM_SHARD_LOCK(data);
+    int index = __getMemoryAllocationIndex(data);
+    if (index != PHASH_NOT_FOUND) {
+        return __localMemoryM._memoryAllocation->size[index];
+    }
+    if (__getArenaContextOf(data) != -1) {
+        return __arenaGetHeader(data)->size;
+    }
+    return -1;
+}
+//////////////////////////////////////////////////////////////////
+/// __getAllocationCapacity
+/// 
+/// Return the number of byte usable by an allocation managed by MemoryM 
+/// without re allocation, -1 if the data is not managed
+int __getAllocationCapacity(void* data) {
+
+    MEMORYM_SHARD_LOCK(data);
+    int index = __getMemoryAllocationIndex(data);
+    if (index != PHASH_NOT_FOUND) {
+        return __localMemoryM._memoryAllocation->allocated[index];
+    }
+    if (__getArenaContextOf(data) != -1) {
+        return __arenaGetHeader(data)->allocated;
+    }
+    return -1;
+}
+//////////////////////////////////////////////////////////////////
+/// __resizeInPlace
+/// 
+/// Change the size of the allocation data if its capacity allows it, the
+/// new byte are set to 0. Return false if the allocation must be moved.
+bool __resizeInPlace(void* data, int size) {
+
+    MEMORYM_SHARD_LOCK(data);
+    int index = __getMemoryAllocationIndex(data);
+    if (index != PHASH_NOT_FOUND) {
+
+        MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+        if (size > array->allocated[index] || array->references[index] > 0) // An interned string is shared
+            return false;
+
+        if (size > array->size[index])
+            memset((char*)data + array->size[index], 0, size - array->size[index]);
+        __countAllocation(index, size - array->size[index], 0);
+        array->size[index] = size;
+        return true;
+    }
+
+    int context = __getArenaContextOf(data);
+    if (context != -1) {
+
+        MemoryArenaHeader* header = __arenaGetHeader(data);
+        if (size > header->allocated)
+            return false;
+
+        if (size > header->size)
+            memset((char*)data + header->size, 0, size - header->size);
+        __countContextAllocation(context, size - header->size, 0);
+        __localMemoryM._contextStack[context].arena.memoryUsed += size - header->size;
+        header->size = size;
+        return true;
+    }
+    return false;
+}
+//////////////////////////////////////////////////////////////////
+/// __copyContent
+/// 
+/// Copy the content of previous to d and set the byte of d after it to 0
+void __copyContent(void* d, int size, void* previous, int previousSize) {
+
+    int copied = previousSize < size ? previousSize : size;
+    memcpy(d, previous, copied);
+    memset((char*)d + copied, 0, size - copied);
+}
+//////////////////////////////////////////////////////////////////
+/// __reAllocCapacity
+/// 
+/// Replace the buffer of the allocation previousAllocation by a new buffer of size byte,
+/// with the capacity to grow up to allocated byte, re using the internal MemoryAllocation 
+/// object or the same arena.
+/// When keepContent is true the content of the previous buffer is copied and the 
+/// new byte are set to 0, else the caller must write the content.
+/// Return NULL if previousAllocation is not managed by MemoryM or if the memory 
+/// is not available, then previousAllocation is kept.
+void* __reAllocCapacity(void* previousAllocation, int size, int allocated, bool keepContent) {
+
+    MEMORYM_SHARD_LOCK(previousAllocation);
+    int index = __getMemoryAllocationIndex(previousAllocation);
+    if (index != PHASH_NOT_FOUND) {
+
+        MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+        if (array->references[index] > 1 && !__canRegister(1)) // The shared string keeps its entry
+            return NULL;
+        void * d                     = __newAllocOnly(allocated, false);
+        if (d == NULL)
+            return NULL;
+        if (keepContent)
+            __copyContent(d, size, array->data[index], array->size[index]);
+
+        if (array->references[index] > 0) { // An interned string is shared, register a new string and release it
+            if (!MemoryAllocation_PushAllocated(array, size, __allocOnlyCapacity(allocated), d)) {
+                __freeAllocOnly(d, allocated);
+                return NULL;
+            }
+            if (array->references[index] > 1)
+                array->references[index]--;
+            else
+                MemoryAllocation_FreeAllocation(array, index);
+            return d;
+        }
+        MemoryAllocation_FreeAllocation(array, index);
+        __setMemoryAllocation(index, size, __allocOnlyCapacity(allocated), d);
+        return d;
+    }
+
+    int context = __getArenaContextOf(previousAllocation);
+    if (context != -1) {
+
+        int previousSize = __arenaGetHeader(previousAllocation)->size;
+        void * d         = __arenaAlloc(context, size, allocated, false);
+        if (d == NULL)
+            return NULL;
+        if (keepContent)
+            __copyContent(d, size, previousAllocation, previousSize);
+
+        __arenaFree(context, previousAllocation);
+        return d;
+    }
+    return NULL;
+}
+void* __reAlloc(void* previousAllocation, int size, bool keepContent) {
+
+    return __reAllocCapacity(previousAllocation, size, size, keepContent);
+}
+bool* __newBool() {
+
+    return (bool*)__newAlloc(sizeof(bool));
+}
+int* __newInt() {
+
+    return (int*)__newAlloc(sizeof(int));
+}
+//////////////////////////////////////////////////////////////////
+/// __stringCapacity
+/// 
+/// Return the capacity to re allocate for a string of size byte with the \0 
+/// built on. A new string is not padded, a short string re written gets the 
+/// inline capacity so the next rewrites are in place
+int __stringCapacity(int size) {
+
+    return size < MEMORYM_INLINE_STRING_SIZE ? MEMORYM_INLINE_STRING_SIZE : size;
+}
+char* __newStringLen(int size) {
+
+    return (char*)__newAllocCapacity(size + 1, size + 1, true);
+}
+//////////////////////////////////////////////////////////////////
+/// __newStringLenUninit
+/// 
+/// Allocate a string of size char without setting its content, only the \0 
+/// at size is written, for a caller writing the whole string
+char* __newStringLenUninit(int size) {
+
+    char * s = (char*)__newAllocCapacity(size + 1, size + 1, false);
+    if (s != NULL)
+        s[size] = '\0';
+    return s;
+}
+char* __newString(const char *s) {
+
+    if (s == NULL)
+        return __newStringLen(0);
+
+    int size = strlen(s);
+    char * newS = __newStringLenUninit(size);
+    if (newS != NULL)
+        memcpy(newS, s, size);
+    return newS;
+}
+// *** Interned strings ***
+// InternString() returns one registered copy per distinct string, found by its hash
+// and length in _internTable. The number of references is kept in the registry so 
+// Free() only releases one reference. The copy is registered out of any context, 
+// a Pop must not free a string still used by the outer contexts.
+
+//////////////////////////////////////////////////////////////////
+/// __internHash
+/// 
+/// FNV-1a hash of s, computed with its length in one pass
+unsigned int __internHash(const char* s, int* length) {
+
+    unsigned int hash = 2166136261u;
+    const char* c     = s;
+    while (*c != '\0') {
+        hash ^= (unsigned char)*c++;
+        hash *= 16777619u;
+    }
+    *length = (int)(c - s);
+    return hash;
+}
+//////////////////////////////////////////////////////////////////
+/// __internFind
+/// 
+/// Return the slot of the interned string s, or the empty slot where to add it
+int __internFind(const char* s, unsigned int hash, int length) {
+
+    MemoryInternTable* table = &__localMemoryM._internTable;
+    int mask                 = table->size - 1;
+    int slot                 = hash & mask;
+
+    while (table->entries[slot].index != -1) {
+
+        MemoryInternEntry* entry = &table->entries[slot];
+        if (entry->hash == hash && entry->length == length && 
+            memcmp(__localMemoryM._memoryAllocation->data[entry->index], s, length) == 0) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+//////////////////////////////////////////////////////////////////
+/// __internResize
+/// 
+/// Re hash the table in size slots, return false and keep the table if the 
+/// memory is not available
+bool __internResize(int size) {
+
+    MemoryInternTable* table   = &__localMemoryM._internTable;
+    MemoryInternEntry* entries = table->entries;
+    int oldSize                = table->size;
+
+    table->entries = (MemoryInternEntry*)__sysMalloc(size * sizeof(MemoryInternEntry));
+    if (table->entries == NULL) {
+        table->entries = entries;
+        return false;
+    }
+    table->size    = size;
+    for (int slot = 0; slot < size; slot++) {
+        table->entries[slot].index = -1;
+    }
+    for (int slot = 0; slot < oldSize; slot++) { // The strings are distinct, only the empty slot is searched
+        if (entries[slot].index != -1) {
+            int i = entries[slot].hash & (size - 1);
+            while (table->entries[i].index != -1) {
+                i = (i + 1) & (size - 1);
+            }
+            table->entries[i] = entries[slot];
+        }
+    }
+    __sysFree(entries, oldSize * sizeof(MemoryInternEntry));
+    return true;
+}
+//////////////////////////////////////////////////////////////////
+/// __internRemove
+/// 
+/// Remove the interned string of the registry entry at index from the table, 
+/// with a backward shift like phash_remove()
+void __internRemove(int index) {
+
+    MemoryInternTable* table = &__localMemoryM._internTable;
+    int length;
+    unsigned int hash        = __internHash((char*)__localMemoryM._memoryAllocation->data[index], &length);
+    int mask                 = table->size - 1;
+    int i                    = hash & mask;
+
+    while (table->entries[i].index != index) {
+        if (table->entries[i].index == -1)
+            return;
+        i = (i + 1) & mask;
+    }
+    table->count--;
+
+    int j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (table->entries[j].index == -1)
+            break;
+
+        int home = table->entries[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) { // Can the entry at j be moved to the hole at i
+            table->entries[i] = table->entries[j];
+            i = j;
+        }
+    }
+    table->entries[i].index = -1;
+}
+char* __internString(const char* s) {
+
+    if (s == NULL)
+        return NULL;
+
+    int length;
+    unsigned int hash = __internHash(s, &length);
+
+    MEMORYM_DRAIN_REMOTE_FREE();
+    #if defined(MEMORYM_SHARED) // The shard is selected by the hash, the same string is always in the same shard
+        MemoryShardLock lock((hash >> 16) & (MEMORYM_SHARD_COUNT - 1));
+    #endif
+    MemoryInternTable* table     = &__localMemoryM._internTable;
+    MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+
+    if ((table->count + 1) * 2 > table->size) { // Keep the load factor under 50%
+        if (!__internResize(table->size == 0 ? 64 : table->size * 2))
+            return NULL;
+    }
+    int slot = __internFind(s, hash, length);
+    if (table->entries[slot].index != -1) { // Hit, nothing allocated
+        int index = table->entries[slot].index;
+        array->references[index]++;
+        return (char*)array->data[index];
+    }
+
+    if (!__canRegister(1))
+        return NULL;
+    char* d   = (char*)__newAllocOnly(length + 1, false);
+    if (d == NULL)
+        return NULL;
+    memcpy(d, s, length + 1);
+    int index = MemoryAllocation_PushGeneration(array, length + 1, __allocOnlyCapacity(length + 1), d, 0);
+    if (index == -1) {
+        __freeAllocOnly(d, length + 1);
+        return NULL;
+    }
+    array->references[index] = 1;
+
+    table->entries[slot].hash   = hash;
+    table->entries[slot].length = length;
+    table->entries[slot].index  = index;
+    table->count++;
+    return d;
+}
+char* __concatString(const char* s, char* previousAllocation) {
+
+    if (s == NULL) { // Support to concat NULL
+        return previousAllocation;
+    }
+
+    if (previousAllocation == NULL) {
+        return __newString(s);
+    }
+    else {
+        int currentSize = __getAllocationSize(previousAllocation); // Already contain the extra char for \0
+        if (currentSize == -1) {
+            return NULL;
+        }
+        else {
+            int len     = strlen(s); // Before s grows when concat with itself
+            int newSize = currentSize + len;
+            char * newS = previousAllocation;
+
+            if (!__resizeInPlace(previousAllocation, newSize)) { // Use the spare capacity first
+                newS = (char*)__reAllocCapacity(previousAllocation, newSize, __stringCapacity(newSize), true);
+                if (newS == NULL)
+                    return NULL;
+                if (s >= previousAllocation && s < previousAllocation + currentSize) { // Concat with itself
+                    s = newS + (s - previousAllocation);
+                }
+            }
+            memmove(newS + strlen(newS), s, len + 1); // s and newS may overlap
+            return newS;
+        }
+    }
+}
+char* __reNewString(const char *s, char* previousAllocation) {
+
+    if (previousAllocation == NULL) {
+        return __newString(s);
+    }
+    else {
+        int size    = strlen(s);
+        char * newS = previousAllocation;
+        if (__resizeInPlace(previousAllocation, size + 1)) { // The pointer does not change
+            memmove(newS, s, size + 1);
+            return newS;
+        }
+        // s in previousAllocation, an interned string, is released by the re allocation
+        char * copy = NULL;
+        if (s >= previousAllocation && s <= previousAllocation + strlen(previousAllocation)) {
+            copy = (char*)__sysMalloc(size + 1);
+            if (copy == NULL)
+                return NULL;
+            memcpy(copy, s, size + 1);
+            s = copy;
+        }
+        newS = (char*)__reAllocCapacity(previousAllocation, size + 1, __stringCapacity(size + 1), false);
+        if (newS != NULL)
+            strcpy(newS, s);
+        __sysFree(copy, size + 1);
+        return newS;
+    }
+}
+//////////////////////////////////////////////////////////////////
+/// __freeLocal
+/// 
+/// Free an allocation of the memory manager of the current thread, with 
+/// MEMORYM_THREAD_LOCAL an allocation of another thread is queued to its owner
+bool __freeLocal(void* data) {
+
+    int index = __getMemoryAllocationIndex(data);
+    if (index == PHASH_NOT_FOUND)  {
+        int context = __getArenaContextOf(data);
+        if (context != -1) {
+            return __arenaFree(context, data);
+        }
+        #if defined(MEMORYM_THREAD_LOCAL)
+            return __remoteFree(data);
+        #else
+            return false;
+        #endif
+    }
+    else {
+        MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+        if (array->references[index] > 1) { // Still used by another InternString()
+            array->references[index]--;
+            return true;
+        }
+        MemoryAllocation_FreeAllocation(array, index);
+        return true;
+    }
+}
+#if defined(MEMORYM_THREAD_LOCAL)
+//////////////////////////////////////////////////////////////////
+/// __drainRemoteFree
+/// 
+/// Free the allocations of the current thread freed by other threads
+void __drainRemoteFree() {
+
+    MemoryOwnerHeader* header = (MemoryOwnerHeader*)__atomicExchangePointer(&__localMemoryM._remoteFree, (MemoryOwnerHeader*)NULL);
+    while (header != NULL) {
+
+        MemoryOwnerHeader* next = header->next;
+        __freeLocal((char*)header + MEMORYM_OWNER_SIZE);
+        header = next;
+    }
+}
+#endif
+bool __free(void* data) {
+
+    if (data == NULL) // Allow to free NULL pointer
+        return true;
+
+    MEMORYM_DRAIN_REMOTE_FREE();
+    MEMORYM_SHARD_LOCK(data);
+    return __freeLocal(data);
+}
+//////////////////////////////////////////////////////////////////
+/// __freeArray
+/// 
+/// Free the n allocations of data, NULL pointers are ignored. 
+/// Return the number of pointers not managed by MemoryM
+int __freeArray(void** data, int n) {
+
+    int error = 0;
+    if (n <= 0)
+        return error;
+
+    MEMORYM_DRAIN_REMOTE_FREE();
+    #if defined(MEMORYM_SHARED) // Free the allocations of each shard under one lock
+        int  buffer[2 * 32]; // Small batches like the ones of FreeMultiple() are grouped on the stack
+        int* shards = n <= 32 ? buffer : (int*)__sysMalloc(2 * n * sizeof(int));
+        if (shards == NULL) { // The pool is exhausted, free by batches grouped on the stack
+            for (int i = 0; i < n; i += 32) {
+                error += __freeArray(data + i, n - i < 32 ? n - i : 32);
+            }
+            return error;
+        }
+        int* order  = shards + n;
+        int  firsts[MEMORYM_SHARD_COUNT + 1];
+
+        for (int i = 0; i < n; i++) {
+            shards[i] = data[i] == NULL ? 0 : __sharedShardOf(data[i]);
+        }
+        __sharedGroupByShard(shards, n, order, firsts);
+
+        for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+            if (firsts[shard] == firsts[shard + 1])
+                continue;
+
+            MemoryShardLock lock(shard);
+            for (int o = firsts[shard]; o < firsts[shard + 1]; o++) {
+                if (data[order[o]] != NULL && !__freeLocal(data[order[o]]))
+                    error += 1;
+            }
+        }
+        if (shards != buffer)
+            __sysFree(shards, 2 * n * sizeof(int));
+        return error;
+    #endif
+    for (int i = 0; i < n; i++) {
+        if (data[i] != NULL && !__freeLocal(data[i]))
+            error += 1;
+    }
+    return error;
+}
+int __freeMultiple(int n, ...) {
+
+    int error = 0;
+    void* data[32]; // The arguments are freed by batch of 32
+    int   batch = sizeof(data) / sizeof(data[0]);
+    va_list vl;
+    va_start(vl, n);
+    for (int i = 0; i < n; i += batch) {
+        int count = n - i < batch ? n - i : batch;
+        for (int j = 0; j < count; j++) {
+            data[j] = va_arg(vl, void*);
+        }
+        error += __freeArray(data, count);
+    }
+    va_end(vl);
+    return error;
+}
+void __freeAll() {
+
+    MEMORYM_DRAIN_REMOTE_FREE();
+
+    // Free all registered memory allocation first
+    int count = __getCount();
+    for (int i = 0; i <= count; i++) {
+
+        MemoryAllocation_FreeAllocation(__localMemoryM._memoryAllocation, i);
+    }
+    // Release the arenas
+    for (int context = __localMemoryM._contextStackIndex; context >= 0; context--) {
+        if (__localMemoryM._contextStack[context].arena.enabled)
+            __arenaRelease(context);
+    }
+    // Free the MemoryAllocation dynamic array and its index
+    #if defined(MEMORYM_THREAD_LOCAL)
+        __unregisterManager(); // No more looked up by the other threads
+    #endif
+    MemoryAllocation_Destructor(__localMemoryM._memoryAllocation);
+    phash_free(__localMemoryM._memoryIndex);
+    FreeSlotBitmap_Destructor(&__localMemoryM._freeSlots);
+    __sysFree(__localMemoryM._internTable.entries, __localMemoryM._internTable.size * sizeof(MemoryInternEntry));
+    __sysFree(__localMemoryM._contextStack, __localMemoryM._contextStackCapacity * sizeof(MemoryContext));
+    #if !defined(MEMORYM_NO_SLAB)
+        __slabDestructor();
+    #endif
+}
+//////////////////////////////////////////////////////////////////
+/// __formatUnsigned
+/// 
+/// Write value in base with digits at out and return the number of char,
+/// when out is NULL only return the number of char
+int __formatUnsigned(unsigned int value, unsigned int base, const char* digits, char* out) {
+
+    char tmpBuf[32];
+    int len = 0;
+    do {
+        tmpBuf[len++] = digits[value % base];
+        value        /= base;
+    } while (value != 0);
+
+    if (out != NULL) {
+        for (int i = 0; i < len; i++) {
+            out[i] = tmpBuf[len - 1 - i];
+        }
+    }
+    return len;
+}
+//////////////////////////////////////////////////////////////////
+/// __formatConversion
+/// 
+/// Consume the argument of the conversion, write its text at out and return
+/// the number of char. When out is NULL only return the number of char.
+int __formatConversion(char conversion, va_list* argptr, char* out) {
+
+    const char* text = NULL;
+    int len          = 0;
+
+    if (conversion == '%') {
+        text = "%";
+        len  = 1;
+    }
+    else if (conversion == 's') { // string, NULL is formated as nothing
+        text = va_arg(*argptr, char *);
+        len  = text == NULL ? 0 : strlen(text);
+    }
+    else if (conversion == 'c') { // character
+        char c = (char)va_arg(*argptr, int);
+        if (c != '\0') {
+            if (out != NULL)
+                out[0] = c;
+            len = 1;
+        }
+    }
+    else if (conversion == 'd') { // integer
+        int d = va_arg(*argptr, int);
+        if (d < 0) {
+            if (out != NULL)
+                *out++ = '-';
+            len = 1 + __formatUnsigned(0U - (unsigned int)d, 10, "0123456789", out);
+        }
+        else {
+            len = __formatUnsigned((unsigned int)d, 10, "0123456789", out);
+        }
+    }
+    else if (conversion == 'u') { // un signed integer
+        len = __formatUnsigned(va_arg(*argptr, unsigned int), 10, "0123456789", out);
+    }
+    else if (conversion == 'x') { // un signed integer hexa
+        len = __formatUnsigned(va_arg(*argptr, unsigned int), 16, "0123456789abcdef", out);
+    }
+    else if (conversion == 'X') { // un signed integer hexa uppercase
+        len = __formatUnsigned(va_arg(*argptr, unsigned int), 16, "0123456789ABCDEF", out);
+    }
+    else if (conversion == 'f') { // float
+        double d = va_arg(*argptr, double);
+        len      = snprintf(NULL, 0, "%f", d);
+        if (out != NULL)
+            snprintf(out, len + 1, "%f", d); // The \0 is overwritten by the next char
+    }
+    else if (conversion == 'b') { // boolean not standard
+        int d = va_arg(*argptr, int);
+        text  = d ? MEMORYM_TRUE : MEMORYM_FALSE;
+        len   = strlen(text);
+    }
+    // Any other conversion is ignored and does not consume an argument
+
+    if (text != NULL && out != NULL) {
+        memcpy(out, text, len);
+    }
+    return len;
+}
+//////////////////////////////////////////////////////////////////
+/// __vformatLength
+/// 
+/// Scan the format to compute the length of the result, without the \0
+int __vformatLength(const char *format, va_list argptr) {
+
+    va_list measure;
+    int len = 0;
+
+    va_copy(measure, argptr);
+    for (const char* f = format; *f != '\0'; f++) {
+        if (*f == '%') {
+            if (*++f == '\0')
+                break;
+            len += __formatConversion(*f, &measure, NULL);
+        }
+        else {
+            len++;
+        }
+    }
+    va_end(measure);
+    return len;
+}
+//////////////////////////////////////////////////////////////////
+/// __vformatWrite
+/// 
+/// Scan the format to write the result in out followed by a \0, 
+/// out must have room for __vformatLength() + 1 char
+void __vformatWrite(char *out, const char *format, va_list argptr) {
+
+    va_list write;
+
+    va_copy(write, argptr);
+    for (const char* f = format; *f != '\0'; f++) {
+        if (*f == '%') {
+            if (*++f == '\0')
+                break;
+            out += __formatConversion(*f, &write, out);
+        }
+        else {
+            *out++ = *f;
+        }
+    }
+    va_end(write);
+    *out = '\0';
+}
+//////////////////////////////////////////////////////////////////
+/// __vformat
+/// 
+/// Scan the format once to compute the length of the result, allocate
+/// the string once, then scan the format again to write the result.
+char * __vformat(const char *format, va_list argptr) {
+
+    char * formated = __newStringLenUninit(__vformatLength(format, argptr));
+    if (formated != NULL)
+        __vformatWrite(formated, format, argptr);
+    return formated;
+}
+//////////////////////////////////////////////////////////////////
+/// __format
+/// Format and allocate a string following the sprintf format
+///     http://www.tutorialspoint.com/c_standard_library/c_function_sprintf.htm
+/// 
+/// Supported: %% %s %c %d %u %x %X %f and %b for a boolean (not standard).
+/// Formating padding is not implemented yet.
+char * __format(const char *format, ...) {
+
+    va_list argptr;
+    va_start(argptr, format);
+    char * formated = __vformat(format, argptr);
+    va_end(argptr);
+    return formated;
+}
+
+//////////////////////////////////////////////////////////////////
+/// __newBuilder
+/// 
+/// Allocate an empty string with the capacity to receive capacityHint char
+/// without re allocation
+char* __newBuilder(int capacityHint) {
+
+    if (capacityHint < 0)
+        capacityHint = 0;
+    char * sb = (char*)__newAllocCapacity(1, capacityHint + 1, false);
+    if (sb != NULL)
+        sb[0] = '\0';
+    return sb;
+}
+//////////////////////////////////////////////////////////////////
+/// __growBuilder
+/// 
+/// Grow the string builder sb to size byte. If the capacity is not enough
+/// the string is moved to a buffer of at least twice the capacity, so n appends
+/// cost O(n) copies. Return NULL if sb is not managed by MemoryM.
+char* __growBuilder(char* sb, int size) {
+
+    if (__resizeInPlace(sb, size))
+        return sb;
+
+    int capacity = __getAllocationCapacity(sb);
+    if (capacity == -1)
+        return NULL;
+
+    return (char*)__reAllocCapacity(sb, size, size > capacity * 2 ? size : capacity * 2, true);
+}
+//////////////////////////////////////////////////////////////////
+/// __append
+/// 
+/// Append len char of s to the string builder sb, all s if len is -1.
+/// Return the string builder which may have moved.
+char* __append(char* sb, const char* s, int len) {
+
+    if (sb == NULL)
+        sb = __newBuilder(len > 0 ? len : 0);
+
+    if (sb == NULL || s == NULL || len == 0)
+        return sb;
+
+    if (len < 0)
+        len = strlen(s);
+
+    int currentSize = __getAllocationSize(sb); // Already contain the extra char for \0
+    int currentLen  = currentSize - 1;         // No strlen(), appending n pieces stays O(n)
+    char * newSb    = __growBuilder(sb, currentSize + len);
+    if (newSb == NULL)
+        return NULL;
+
+    if (newSb != sb && s >= sb && s < sb + currentSize) { // Append to itself
+        s = newSb + (s - sb);
+    }
+    memmove(newSb + currentLen, s, len);
+    newSb[currentLen + len] = '\0';
+    return newSb;
+}
+//////////////////////////////////////////////////////////////////
+/// __appendFormat
+/// 
+/// Append to the string builder sb following the Format() format, without
+/// allocating a temporary string
+char* __appendFormat(char* sb, const char* format, ...) {
+
+    va_list argptr;
+    va_start(argptr, format);
+
+    int len = __vformatLength(format, argptr);
+    if (sb == NULL)
+        sb = __newBuilder(len);
+    if (sb == NULL) {
+        va_end(argptr);
+        return NULL;
+    }
+
+    int currentSize = __getAllocationSize(sb);
+    int currentLen  = currentSize - 1;
+    char * newSb    = __growBuilder(sb, currentSize + len);
+    if (newSb != NULL)
+        __vformatWrite(newSb + currentLen, format, argptr);
+
+    va_end(argptr);
+    return newSb;
+}
+//////////////////////////////////////////////////////////////////
+/// __toString
+/// 
+/// Give back the spare capacity of the string builder sb, which becomes a
+/// regular string. Return the string which may have moved.
+char* __toString(char* sb) {
+
+    MEMORYM_SHARD_LOCK(sb);
+    int index = __getMemoryAllocationIndex(sb);
+    if (index == PHASH_NOT_FOUND)
+        return sb; // Arena allocations are released with their context
+
+    MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+    int size                     = array->size[index];
+
+    if (array->allocated[index] == __allocOnlyCapacity(size))
+        return sb;
+
+    if (__allocOnlyClass(size) == -1 && __allocOnlyClass(array->allocated[index]) == -1) {
+
+        __indexRemove(sb);
+        MEMORYM_SHARD_MOVED(sb, false);
+        char * d = (char*)__sysRealloc(sb - MEMORYM_OWNER_SIZE, array->allocated[index] + MEMORYM_OWNER_SIZE, size + MEMORYM_OWNER_SIZE); // Shrink, usually without moving
+        d        = d == NULL ? sb : d + MEMORYM_OWNER_SIZE;
+        __indexPut(d, index);
+        MEMORYM_SHARD_MOVED(d, true);
+        array->data[index] = d;
+        array->allocated[index] = size;
+        return d;
+    }
+    return (char*)__reAlloc(sb, size, true);
+}
+
+//////////////////////////////////////////////////////////////////
+/// MemoryReportSink
+/// 
+MemoryReportSink MemoryReportSink_File(FILE* file) {
+
+    MemoryReportSink sink = { file, -1, NULL, NULL };
+    return sink;
+}
+MemoryReportSink MemoryReportSink_Fd(int fd) {
+
+    MemoryReportSink sink = { NULL, fd, NULL, NULL };
+    return sink;
+}
+MemoryReportSink MemoryReportSink_Callback(MemoryReportWrite write, void* userData) {
+
+    MemoryReportSink sink = { NULL, -1, write, userData };
+    return sink;
+}
+
+#define MEMORYM_REPORT_MAX_ROW 192 // Longest row formatted by __reportRow(), a row of the site report
+
+typedef struct {
+
+    MemoryReportSink* sink;
+    char buffer[MEMORYM_MAX_REPORT_SIZE];
+    int  len;
+    bool ok;
+} MemoryReportWriter;
+
+//////////////////////////////////////////////////////////////////
+/// __reportFlush
+/// 
+/// Write the buffered rows to the sink
+void __reportFlush(MemoryReportWriter* writer) {
+
+    MemoryReportSink* sink = writer->sink;
+    char* data             = writer->buffer;
+    int len                = writer->len;
+
+    writer->len = 0;
+    if (len == 0 || !writer->ok)
+        return;
+
+    if (sink->file != NULL) {
+        writer->ok = fwrite(data, 1, len, sink->file) == (size_t)len;
+    }
+    else if (sink->fd != -1) {
+        while (len > 0) { // write() can be partial
+            int written = (int)__writeFd(sink->fd, data, len);
+            if (written <= 0) {
+                writer->ok = false;
+                return;
+            }
+            data += written;
+            len  -= written;
+        }
+    }
+    else if (sink->write != NULL) {
+        sink->write(sink->userData, data, len);
+    }
+}
+//////////////////////////////////////////////////////////////////
+/// __reportRow
+/// 
+/// Format a row in the buffer, flush first if the buffer cannot receive a row of 
+/// MEMORYM_REPORT_MAX_ROW char. A longer row which does not fit is formatted again 
+/// in the empty buffer, truncated to it if still too long
+void __reportRow(MemoryReportWriter* writer, const char* format, ...) {
+
+    if (MEMORYM_MAX_REPORT_SIZE - writer->len < MEMORYM_REPORT_MAX_ROW)
+        __reportFlush(writer);
+
+    va_list argptr;
+    va_list retry;
+    va_start(argptr, format);
+    va_copy(retry, argptr);
+    int space = MEMORYM_MAX_REPORT_SIZE - writer->len;
+    int len   = vsnprintf(writer->buffer + writer->len, space, format, argptr);
+    if (len >= space && writer->len > 0) {
+        __reportFlush(writer);
+        space = MEMORYM_MAX_REPORT_SIZE;
+        len   = vsnprintf(writer->buffer, space, format, retry);
+    }
+    va_end(retry);
+    va_end(argptr);
+    if (len >= space)
+        len = space - 1; // vsnprintf() returns the length of the whole row
+    if (len > 0)
+        writer->len += len;
+}
+//////////////////////////////////////////////////////////////////
+/// __writeReportRows
+/// 
+/// Stream the rows of the registry entries 0 to count of __localMemoryM but the 
+/// entry of exclude, first is true until a row is written
+void __writeReportRows(MemoryReportWriter* writer, int options, int count, void* exclude, bool* first) {
+
+    MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+    int format                   = options & ~MEMORYM_REPORT_LIVE_ONLY;
+    bool liveOnly                = (options & MEMORYM_REPORT_LIVE_ONLY) != 0;
+
+    for (int i = 0; i <= count; i++) {
+
+        if ((liveOnly && array->data[i] == NULL) || (exclude != NULL && array->data[i] == exclude))
+            continue;
+
+        if (format == MEMORYM_REPORT_CSV) {
+            __reportRow(writer, "%d,%d,%d,0x%llx,%d,%d\r\n", i, array->size[i], array->allocated[i], 
+                (unsigned long long)(size_t)array->data[i], __getContextOfIndex(i), array->references[i]);
+        }
+        else if (format == MEMORYM_REPORT_JSON) {
+            __reportRow(writer, "%s\r\n{\"index\":%d,\"size\":%d,\"allocated\":%d,\"address\":\"0x%llx\",\"context\":%d,\"references\":%d}", 
+                *first ? "" : ",", i, array->size[i], array->allocated[i], 
+                (unsigned long long)(size_t)array->data[i], __getContextOfIndex(i), array->references[i]);
+        }
+        else if (array->references[i] > 0) { // An interned string is reported once with its references
+            __reportRow(writer, "[%3d] %5d - %X - interned x%d\r\n", i, array->size[i], (unsigned int)(size_t)array->data[i], array->references[i]);
+        }
+        else {
+            __reportRow(writer, "[%3d] %5d - %X\r\n", i, array->size[i], (unsigned int)(size_t)array->data[i]);
+        }
+        *first = false;
+    }
+}
+//////////////////////////////////////////////////////////////////
+/// __writeReportOf
+/// 
+/// Stream the report of the registry entries 0 to count but the entry of exclude, 
+/// used and live are the totals of the footer. Arena allocations are only counted 
+/// in the totals. With MEMORYM_SHARED count is ignored and the rows of every shard 
+/// are written, the index of a row is its index in its shard.
+bool __writeReportOf(MemoryReportSink* sink, int options, int count, int used, int live, void* exclude) {
+
+    int format  = options & ~MEMORYM_REPORT_LIVE_ONLY;
+    bool first  = true;
+    MemoryReportWriter writer;
+
+    writer.sink = sink;
+    writer.len  = 0;
+    writer.ok   = true;
+
+    if (format == MEMORYM_REPORT_CSV)
+        __reportRow(&writer, "index,size,allocated,address,context,references\r\n");
+    else if (format == MEMORYM_REPORT_JSON)
+        __reportRow(&writer, "{\"allocations\":[");
+
+    #if defined(MEMORYM_SHARED)
+        for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+            MemoryShardLock lock(shard);
+            __writeReportRows(&writer, options, __getCount(), exclude, &first);
+        }
+    #else
+        __writeReportRows(&writer, options, count, exclude, &first);
+    #endif
+
+    if (format == MEMORYM_REPORT_JSON)
+        __reportRow(&writer, "\r\n],\"used\":%d,\"live\":%d,\"count\":%d}\r\n", used, live, count);
+    else if (format != MEMORYM_REPORT_CSV) // No CSV footer, every row has the same columns
+        __reportRow(&writer, "Used:%5d, Count:%5d\r\n", used, count);
+
+    __reportFlush(&writer);
+    return writer.ok;
+}
+//////////////////////////////////////////////////////////////////
+/// __writeReport
+/// 
+/// Stream the report of the current memory allocation to sink through a 
+/// buffer on the stack, so the report does not change the memory it describes
+bool __writeReport(MemoryReportSink* sink, int options) {
+
+    if (sink == NULL)
+        return false;
+    return __writeReportOf(sink, options, memoryM()->GetCount(), memoryM()->GetMemoryUsed(), memoryM()->GetLiveCount(), NULL);
+}
+typedef struct {
+
+    char* data;     // NULL to only measure the report
+    int   len;
+    int   capacity;
+} MemoryReportBuffer;
+
+void __reportToBuffer(void* userData, char* data, int len) {
+
+    MemoryReportBuffer* buffer = (MemoryReportBuffer*)userData;
+    if (buffer->data == NULL) {
+        buffer->len += len;
+        return;
+    }
+    if (len > buffer->capacity - buffer->len) // The registry changed since the measure
+        len = buffer->capacity - buffer->len;
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+}
+//////////////////////////////////////////////////////////////////
+/// __getReport
+/// 
+/// Like Format(), stream the report once to measure it, allocate the string
+/// once, then stream the report again in the string. No lock is held while 
+/// the string is allocated. The row of the string is left out of the second 
+/// report, which is not longer than the first when the registry does not change.
+char * __getReport() {
+
+    int count = memoryM()->GetCount(); // The report does not contain its own allocation
+    int used  = memoryM()->GetMemoryUsed();
+    int live  = memoryM()->GetLiveCount();
+    MemoryReportBuffer buffer = { NULL, 0, 0 };
+
+    MemoryReportSink sink = MemoryReportSink_Callback(__reportToBuffer, &buffer);
+    __writeReportOf(&sink, MEMORYM_REPORT_TEXT, count, used, live, NULL);
+
+    buffer.capacity = buffer.len;
+    buffer.len      = 0;
+    buffer.data     = __newStringLen(buffer.capacity);
+    if (buffer.data != NULL)
+        __writeReportOf(&sink, MEMORYM_REPORT_TEXT, count, used, live, buffer.data);
+    return buffer.data;
+}
+//////////////////////////////////////////////////////////////////
+/// __writeSiteReportOf
+/// 
+/// Stream the report of the n sites, with the non empty buckets of their histogram
+bool __writeSiteReportOf(MemoryReportSink* sink, MemorySite* sites, int n) {
+
+    MemoryReportWriter writer;
+    writer.sink = sink;
+    writer.len  = 0;
+    writer.ok   = true;
+
+    __reportRow(&writer, "Sites:%5d\r\n", n);
+    __reportRow(&writer, "%10s %12s %12s %10s  %s\r\n", "count", "bytes", "live bytes", "frees", "site");
+    for (int i = 0; i < n; i++) {
+
+        MemorySite* site = &sites[i];
+        const char* file = site->file;
+        for (const char* c = site->file; *c != '\0'; c++) { // Only the name of the file
+            if (*c == '/' || *c == '\\')
+                file = c + 1;
+        }
+        __reportRow(&writer, "%10lld %12lld %12lld %10lld  %.48s:%d %.48s\r\n", 
+            site->count, site->bytes, site->liveBytes, site->frees, file, site->line, site->function);
+
+        __reportRow(&writer, "%10s", "sizes");
+        for (int bucket = 0; bucket < MEMORYM_SITE_HISTOGRAM; bucket++) {
+            if (site->histogram[bucket] == 0)
+                continue;
+            if (bucket == MEMORYM_SITE_HISTOGRAM - 1)
+                __reportRow(&writer, " >%d:%lld", 4 << bucket, site->histogram[bucket]);
+            else
+                __reportRow(&writer, " %d-%d:%lld", bucket == 0 ? 1 : (4 << bucket) + 1, 8 << bucket, site->histogram[bucket]);
+        }
+        __reportRow(&writer, "\r\n");
+    }
+    __reportFlush(&writer);
+    return writer.ok;
+}
+int __compareSites(const void* a, const void* b) {
+
+    long long bytesA = ((MemorySite*)a)->bytes;
+    long long bytesB = ((MemorySite*)b)->bytes;
+    return bytesA < bytesB ? 1 : bytesA > bytesB ? -1 : 0;
+}
+//////////////////////////////////////////////////////////////////
+/// __getSiteReport
+/// 
+/// Copy the sites, sort them by byte allocated and report the count first ones 
+/// like __getReport(), all of them if count is -1
+char * __getSiteReport(int count) {
+
+    MemorySite* sites = NULL;
+    int n             = 0;
+    int capacity      = 0;
+    #if defined(MEMORYM_SITE_STATS)
+    {
+        MEMORYM_SITES_LOCK();
+        capacity = __sitesCount + 1;
+        sites    = (MemorySite*)__sysMalloc(capacity * sizeof(MemorySite));
+        for (int i = 0; sites != NULL && i < MEMORYM_SITE_COUNT; i++) {
+            if (__sites[i].file != NULL)
+                sites[n++] = __sites[i];
+        }
+    }
+    qsort(sites, n, sizeof(MemorySite), __compareSites);
+    #endif
+    if (count >= 0 && count < n)
+        n = count;
+
+    MemoryReportBuffer buffer = { NULL, 0, 0 };
+    MemoryReportSink sink     = MemoryReportSink_Callback(__reportToBuffer, &buffer);
+    __writeSiteReportOf(&sink, sites, n);
+
+    buffer.capacity = buffer.len;
+    buffer.len      = 0;
+    buffer.data     = __newStringLen(buffer.capacity);
+    if (buffer.data != NULL)
+        __writeSiteReportOf(&sink, sites, n);
+    __sysFree(sites, capacity * sizeof(MemorySite));
+    return buffer.data;
+}
+#if defined(MEMORYM_HEAP_PROFILE)
+//////////////////////////////////////////////////////////////////
+/// __writeFrameName
+/// 
+/// Write the function of the return address stack[frame] for a folded stack, the 
+/// demangled name when the executable exports it (-rdynamic), else the address
+void __writeFrameName(MemoryReportWriter* writer, void** stack, char** symbols, int frame) {
+
+    #ifndef _MSC_VER
+        char* symbol = symbols != NULL ? symbols[frame] : NULL; // module(name+offset) [address]
+        char* begin  = symbol != NULL ? strchr(symbol, '(') : NULL;
+        char* end    = begin != NULL ? strpbrk(begin, "+)") : NULL;
+        if (end != NULL && end > begin + 1) {
+            char name[MEMORYM_REPORT_MAX_ROW];
+            int  len = (int)(end - begin - 1) < MEMORYM_REPORT_MAX_ROW - 1 ? (int)(end - begin - 1) : MEMORYM_REPORT_MAX_ROW - 1;
+            memcpy(name, begin + 1, len);
+            name[len] = '\0';
+
+            int status;
+            char* demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+            __reportRow(writer, "%.96s", status == 0 ? demangled : name);
+            free(demangled);
+            return;
+        }
+    #endif
+    __reportRow(writer, "0x%llx", (unsigned long long)(size_t)stack[frame]);
+}
+//////////////////////////////////////////////////////////////////
+/// __writeHeapProfileOf
+/// 
+/// Stream the n samples. MEMORYM_PROFILE_PPROF writes the legacy heap profile of 
+/// pprof, which scales the samples with the rate, followed by the mapping of the
+/// modules. MEMORYM_PROFILE_FOLDED writes one line per sample, the frames from the
+/// root and the estimated byte allocated by the stack, size / (1 - exp(-size / rate))
+bool __writeHeapProfileOf(MemoryReportSink* sink, MemorySample* samples, int n, int rate, int format) {
+
+    MemoryReportWriter writer;
+    writer.sink = sink;
+    writer.len  = 0;
+    writer.ok   = true;
+
+    if (format == MEMORYM_PROFILE_PPROF) {
+
+        long long bytes = 0;
+        for (int i = 0; i < n; i++) {
+            bytes += samples[i].size;
+        }
+        __reportRow(&writer, "heap profile: %6d: %8lld [%6d: %8lld] @ heap_v2/%d\n", n, bytes, n, bytes, rate);
+        for (int i = 0; i < n; i++) {
+            __reportRow(&writer, "%6d: %8d [%6d: %8d] @", 1, samples[i].size, 1, samples[i].size);
+            for (int frame = 0; frame < samples[i].depth; frame++) {
+                __reportRow(&writer, " 0x%llx", (unsigned long long)(size_t)samples[i].stack[frame]);
+            }
+            __reportRow(&writer, "\n");
+        }
+        __reportRow(&writer, "\nMAPPED_LIBRARIES:\n");
+        #if defined(__linux__)
+            FILE* maps = fopen("/proc/self/maps", "r");
+            if (maps != NULL) {
+                char chunk[MEMORYM_REPORT_MAX_ROW / 2];
+                int len;
+                while ((len = (int)fread(chunk, 1, sizeof(chunk), maps)) > 0) {
+                    __reportRow(&writer, "%.*s", len, chunk);
+                }
+                fclose(maps);
+            }
+        #endif
+    }
+    else {
+        for (int i = 0; i < n; i++) {
+            char** symbols = NULL;
+            #ifndef _MSC_VER
+                symbols = backtrace_symbols(samples[i].stack, samples[i].depth);
+            #endif
+            for (int frame = samples[i].depth - 1; frame >= 0; frame--) {
+                __writeFrameName(&writer, samples[i].stack, symbols, frame);
+                if (frame > 0)
+                    __reportRow(&writer, ";");
+            }
+            double size = samples[i].size;
+            __reportRow(&writer, " %lld\n", (long long)(size / (1 - exp(-size / rate)) + 0.5));
+            free(symbols);
+        }
+    }
+    __reportFlush(&writer);
+    return writer.ok;
+}
+#endif
+//////////////////////////////////////////////////////////////////
+/// __writeHeapProfile
+/// 
+/// Copy the live samples and stream them with __writeHeapProfileOf() without the
+/// lock, the sink may allocate
+bool __writeHeapProfile(MemoryReportSink* sink, int format) {
+
+    #if defined(MEMORYM_HEAP_PROFILE)
+        MemorySample* samples = NULL;
+        int n                 = 0;
+        int rate              = 0;
+        int capacity          = 0;
+        {
+            MEMORYM_SAMPLES_LOCK();
+            capacity = __samplesLive + 1;
+            samples  = (MemorySample*)__sysMalloc(capacity * sizeof(MemorySample));
+            rate    = __sampleRate;
+            for (int i = 0; samples != NULL && i < __samplesCapacity; i++) {
+                if (__samples[i].size != -1)
+                    samples[n++] = __samples[i];
+            }
+        }
+        if (samples == NULL)
+            return false;
+        bool ok = __writeHeapProfileOf(sink, samples, n, rate, format);
+        __sysFree(samples, capacity * sizeof(MemorySample));
+        return ok;
+    #else
+        (void)sink;
+        (void)format;
+        return false;
+    #endif
+}
+int __getMemoryUsed() {
+
+    return __localMemoryM._memoryUsed;
+}
+int __getLiveCount() {
+
+    return __localMemoryM._liveCount;
+}
+int __getPeakMemoryUsed() {
+
+    return __localMemoryM._peakMemoryUsed;
+}
+int __getContextMemoryUsed(int level) {
+
+    if (level < 0 || level > __localMemoryM._contextStackIndex)
+        return -1;
+
+    return __localMemoryM._contextStack[level].memoryUsed;
+}
+//////////////////////////////////////////////////////////////////
+/// __getStats
+/// 
+/// Copy the running counters, the context stack up to MEMORYM_STATS_CONTEXT_COUNT 
+/// levels, the timeline from the oldest sample and the counters of the pool
+void __getStats(MemoryStats* stats) {
+
+    stats->memoryUsed     = __localMemoryM._memoryUsed;
+    stats->liveCount      = __localMemoryM._liveCount;
+    stats->peakMemoryUsed = __localMemoryM._peakMemoryUsed;
+    stats->peakLiveCount  = __localMemoryM._peakLiveCount;
+    stats->contextLevel   = __localMemoryM._contextStackIndex;
+    for (int level = 0; level < MEMORYM_STATS_CONTEXT_COUNT; level++) {
+        bool pushed = level <= __localMemoryM._contextStackIndex;
+        stats->contextMemoryUsed[level]     = pushed ? __localMemoryM._contextStack[level].memoryUsed : 0;
+        stats->contextPeakMemoryUsed[level] = pushed ? __localMemoryM._contextStack[level].peakMemoryUsed : 0;
+    }
+    stats->timelineCount = 0;
+    #if MEMORYM_TIMELINE_SIZE > 0
+        MemoryTimeline* timeline = &__localMemoryM._timeline;
+        int first = (timeline->next - timeline->count + MEMORYM_TIMELINE_SIZE) % MEMORYM_TIMELINE_SIZE;
+        for (int i = 0; i < timeline->count; i++) {
+            stats->timeline[i] = timeline->samples[(first + i) % MEMORYM_TIMELINE_SIZE];
+        }
+        stats->timelineCount = timeline->count;
+    #endif
+    __poolGetStats(stats);
+}
+void __Initialize() {
+
+    __localMemoryM._memoryAllocation  = MemoryAllocation_New();
+    __localMemoryM._memoryIndex       = phash_init();
+    FreeSlotBitmap_Init(&__localMemoryM._freeSlots);
+    memset(&__localMemoryM._internTable, 0, sizeof(MemoryInternTable));
+    __localMemoryM._memoryUsed        = 0;
+    __localMemoryM._liveCount         = 0;
+    __localMemoryM._peakMemoryUsed    = 0;
+    __localMemoryM._peakLiveCount     = 0;
+    #if MEMORYM_TIMELINE_SIZE > 0
+        memset(&__localMemoryM._timeline, 0, sizeof(MemoryTimeline));
+    #endif
+    __localMemoryM._contextStack         = NULL;
+    __localMemoryM._contextStackIndex    = -1;
+    __localMemoryM._contextStackCapacity = 0;
+    __localMemoryM._contextGeneration    = 0;
+    __localMemoryM.PushContext(); // Always save a context a 0
+    #if defined(MEMORYM_THREAD_LOCAL)
+        __registerManager();
+    #endif
+}
+//////////////////////////////////////////////////////////////////
+/// __PushContext
+/// 
+/// Push in the stack the current state of the memory manager
+bool __PushContext() {
+
+    int level = __localMemoryM._contextStackIndex + 1;
+
+    if (level == __localMemoryM._contextStackCapacity) { // Grow the stack
+
+        int capacity          = level == 0 ? MEMORYM_STACK_CONTEXT_SIZE : level * 2;
+        MemoryContext * stack = (MemoryContext*)__sysRealloc(__localMemoryM._contextStack, level * sizeof(MemoryContext), capacity * sizeof(MemoryContext));
+        if (stack == NULL)
+            return false;
+
+        memset(stack + level, 0, (capacity - level) * sizeof(MemoryContext));
+        __localMemoryM._contextStack         = stack;
+        __localMemoryM._contextStackCapacity = capacity;
+    }
+
+    MemoryContext * context = &__localMemoryM._contextStack[level];
+    context->generation     = ++__localMemoryM._contextGeneration;
+    context->first          = -1;
+    context->memoryUsed     = 0;
+    context->peakMemoryUsed = 0;
+    context->arena.enabled  = false;
+
+    __localMemoryM._contextStackIndex = level;
+    return true;
+}
+//////////////////////////////////////////////////////////////////
+/// __PushArenaContext
+/// 
+/// Push in the stack the current state of the memory manager, the allocations
+/// until the next Pop are allocated in an arena owned by the context
+bool __PushArenaContext() {
+
+    if (!__PushContext())
+        return false;
+
+    __localMemoryM._contextStack[__localMemoryM._contextStackIndex].arena.enabled = true;
+    return true;
+}
+//////////////////////////////////////////////////////////////////
+/// __PopContext
+/// 
+/// Restore the state of the memory manager based on the last push
+bool __PopContext() {
+
+    MEMORYM_DRAIN_REMOTE_FREE();
+
+    if (__localMemoryM._contextStackIndex > -1) {
+
+        MemoryAllocationArray* array = __localMemoryM._memoryAllocation;
+        int index                    = __localMemoryM._contextStack[__localMemoryM._contextStackIndex].first;
+
+        while (index != -1) { // Only the entries of the context, wherever they are in the registry
+            
+            int next = array->next[index];
+            MemoryAllocation_FreeAllocation(array, index); // Free the allocation, the context is still on the stack for the counters
+            index    = next;
+        }
+        while (array->last >= 0 && array->data[array->last] == NULL) { // Remove the available entries at the end of the array
+            
+            FreeSlotBitmap_Clear(&__localMemoryM._freeSlots, array->last); // The entry does not exist anymore
+            MemoryAllocation_Pop(array);
+        }
+        if (__localMemoryM._contextStack[__localMemoryM._contextStackIndex].arena.enabled) {
+            __arenaRelease(__localMemoryM._contextStackIndex); // Release the chunks, no free per allocation
+        }
+        __localMemoryM._contextStackIndex--;
+        return true;
+    }
+    else 
+        return false;
+}
+// *** Cached clock ***
+// The broken down local time of now is cached per thread. In the same second the
+// cache is returned as is, in the same hour only the minutes and seconds move, 
+// localtime_r() is called when the hour changes, because the daylight saving 
+// time only changes on an hour, or when the clock goes back.
+
+#if defined(WINFORMEBBLE) // Single thread, no localtime_r()
+    #define MEMORYM_CLOCK_TLS
+    #define __localtime(t, tm) (*(tm) = *localtime(t))
+#elif defined(_MSC_VER)
+    #define MEMORYM_CLOCK_TLS thread_local
+    #define __localtime(t, tm) localtime_s((tm), (t))
+#else
+    #define MEMORYM_CLOCK_TLS thread_local
+    #define __localtime(t, tm) localtime_r((t), (tm))
+#endif
+
+typedef struct {
+
+    time_t    time; // 0 until the first call
+    struct tm tm;   // Local time of time
+} MemoryClock;
+
+static MEMORYM_CLOCK_TLS MemoryClock __clock;
+
+//////////////////////////////////////////////////////////////////
+/// __now
+/// 
+/// Copy the local time of now in date
+void __now(struct tm * date) {
+
+    time_t now = time(NULL);
+    if (now != __clock.time) {
+
+        int secondOfHour = __clock.tm.tm_min * 60 + __clock.tm.tm_sec + (int)(now - __clock.time);
+        if (__clock.time != 0 && now > __clock.time && secondOfHour < 3600) {
+            __clock.tm.tm_min = secondOfHour / 60;
+            __clock.tm.tm_sec = secondOfHour % 60;
+        }
+        else {
+            __localtime(&now, &__clock.tm);
+        }
+        __clock.time = now;
+    }
+    memcpy(date, &__clock.tm, sizeof(struct tm));
+}
+struct tm * __newDate() {
+
+    struct tm * date = (struct tm *)__newAlloc(sizeof(struct tm));
+    if (date != NULL)
+        __now(date);
+    return date;
+}
+//////////////////////////////////////////////////////////////////
+/// __reNewDate
+/// 
+/// Set the date previousAllocation to now in place, return NULL if 
+/// previousAllocation is not managed by MemoryM or the memory is not available
+struct tm * __reNewDate(struct tm * previousAllocation) {
+
+    if (previousAllocation == NULL) {
+        return __newDate();
+    }
+    int size = __getAllocationSize(previousAllocation);
+    if (size == -1) {
+        return NULL;
+    }
+    if (size != sizeof(struct tm)) {
+        previousAllocation = (struct tm *)__reAlloc(previousAllocation, sizeof(struct tm), false);
+        if (previousAllocation == NULL)
+            return NULL;
+    }
+    __now(previousAllocation);
+    return previousAllocation;
+}
+struct tm * __newDateTime(int year, int month, int day, int hour, int minutes, int seconds) {
+
+    struct tm * d = __newDate();
+    if (d == NULL)
+        return NULL;
+
+    d->tm_sec    = seconds;
+    d->tm_min    = minutes;
+    d->tm_hour   = hour;
+    d->tm_min    = minutes;
+    d->tm_mday   = day;
+    d->tm_mon    = month - 1;
+    d->tm_year   = year - 1900;
+    //d->tm_wday = ?;
+    //d->tm_yday = ?;
+    d->tm_isdst  = 0;
+
+    return d;
+}
+// *** Formatted date cache ***
+// The last dates formatted by the thread are cached with their format, so a clock 
+// formatting the same date many times per second calls strftime() once per second.
+
+typedef struct {
+
+    struct tm date;
+    char      format[MEMORYM_DATE_CACHE_TEXT];
+    char      text[MEMORYM_DATE_CACHE_TEXT];
+    int       length;
+} MemoryDateCacheEntry;
+
+static MEMORYM_CLOCK_TLS MemoryDateCacheEntry __dateCache[MEMORYM_DATE_CACHE_SIZE];
+static MEMORYM_CLOCK_TLS int                  __dateCacheNext; // Entry replaced by the next miss
+
+//////////////////////////////////////////////////////////////////
+/// __strftimeLong
+/// 
+/// Format date in a buffer allocated with malloc() growing until the text fits,
+/// its size is set in *allocated. strftime() returns 0 when the buffer is too small 
+/// but also for an empty text, so the growth stops at 256 byte per char of the 
+/// format. Return NULL if the memory is not available.
+char* __strftimeLong(struct tm *date, const char* format, int* length, int* allocated) {
+
+    int maxSize = 256 * ((int)strlen(format) + 1);
+    int size    = MEMORYM_DATE_CACHE_TEXT * 2;
+    char* text  = (char*)__sysMalloc(size);
+    if (text == NULL)
+        return NULL;
+    while ((*length = (int)strftime(text, size, format, date)) == 0 && size < maxSize) {
+        char* grown = (char*)__sysRealloc(text, size, size * 2);
+        if (grown == NULL) {
+            __sysFree(text, size);
+            return NULL;
+        }
+        text  = grown;
+        size *= 2;
+    }
+    *allocated = size;
+    if (*length == 0) {
+        text[0] = '\0';
+    }
+    return text;
+}
+//////////////////////////////////////////////////////////////////
+/// __strftime
+/// 
+/// Return date formatted with strftime() and its length, from the date cache if 
+/// the same date was formatted with the same format. A text too long for the 
+/// cache is allocated with malloc(), *allocated is then its size and the caller must free it
+char* __strftime(struct tm *date, const char* format, int* length, int* allocated) {
+
+    *allocated = 0;
+    for (int i = 0; i < MEMORYM_DATE_CACHE_SIZE; i++) {
+
+        MemoryDateCacheEntry* entry = &__dateCache[i];
+        if (memcmp(&entry->date, date, sizeof(struct tm)) == 0 && strcmp(entry->format, format) == 0) {
+            *length = entry->length;
+            return entry->text;
+        }
+    }
+
+    if (strlen(format) < MEMORYM_DATE_CACHE_TEXT) {
+
+        MemoryDateCacheEntry* entry = &__dateCache[__dateCacheNext];
+        int len = (int)strftime(entry->text, MEMORYM_DATE_CACHE_TEXT, format, date);
+        if (len > 0 || format[0] == '\0') {
+            memcpy(&entry->date, date, sizeof(struct tm));
+            strcpy(entry->format, format);
+            entry->length   = len;
+            __dateCacheNext = (__dateCacheNext + 1) % MEMORYM_DATE_CACHE_SIZE;
+            *length         = len;
+            return entry->text;
+        }
+        entry->format[0] = '\0'; // Do not match with the text overwritten
+        entry->text[0]   = '\0';
+        entry->length    = 0;
+    }
+    return __strftimeLong(date, format, length, allocated);
+}
+char* __formatDateTime(struct tm *date, const char* format) {
+
+    int length;
+    int allocated;
+    char* text = __strftime(date, format, &length, &allocated);
+    if (text == NULL)
+        return NULL;
+    char* s    = __newStringLenUninit(length);
+    if (s != NULL)
+        memcpy(s, text, length);
+    if (allocated)
+        __sysFree(text, allocated);
+    return s;
+}
+//////////////////////////////////////////////////////////////////
+/// __reFormatDateTime
+/// 
+/// Format date in previousAllocation, in place if the text fits in its capacity.
+/// Return NULL if previousAllocation is not managed by MemoryM
+char* __reFormatDateTime(struct tm *date, const char* format, char * previousAllocation) {
+
+    if (previousAllocation == NULL) {
+        return __formatDateTime(date, format);
+    }
+    int length;
+    int allocated;
+    char* text = __strftime(date, format, &length, &allocated);
+    if (text == NULL)
+        return NULL;
+    char* s    = previousAllocation;
+    if (!__resizeInPlace(s, length + 1)) {
+        s = (char*)__reAllocCapacity(previousAllocation, length + 1, __stringCapacity(length + 1), false);
+    }
+    if (s != NULL) {
+        memcpy(s, text, length);
+        s[length] = '\0';
+    }
+    if (allocated)
+        __sysFree(text, allocated);
+    return s;
+}
+#if !defined(WINFORMEBBLE)
+
+    void assertString(const char *s1, const char *s2) {
+        assert(!strcmp(s1, s2));
+    }
+    void assertDate(struct tm * date, int year, int month, int day, int hour, int minutes, int seconds) {
+
+        assert((year - 1900) == date->tm_year);
+        assert(month         == date->tm_mon + 1); // Month start a 0
         assert(day           == date->tm_mday);
         assert(hour          == date->tm_hour);
         assert(minutes       == date->tm_min);
         assert(seconds       == date->tm_sec);
     }
 
-    //////////////////////////////////////////////////////////////////
-    /// MemoryM 
-    /// A simple memory manager for C.
-    /// The function memoryM() returns the singleton object
-    void __Samples() {
+    //////////////////////////////////////////////////////////////////
+    /// MemoryM 
+    /// A simple memory manager for C.
+    /// The function memoryM() returns the singleton object
+    void __Samples() {
+
+        bool * b1                    = memoryM()->NewBool();
+        int  * i1                    = memoryM()->NewInt();
+        struct tm * now              = memoryM()->NewDate();
+        struct tm * specificDateTime = memoryM()->NewDateTime(2014, 11, 22, 1, 2, 3);
+
+        // Allocate string
+        char * s1  = memoryM()->NewStringLen(10);    
+        char * s2  = memoryM()->NewString("Hello World");
+        char * s22 = memoryM()->StringConcat(" Joe", s2);
+        
+        memoryM()->FreeMultiple(2, s1, s2, s22);
+    
+        // Format and allocate string
+        char * s3 = memoryM()->Format("b:%b, b:%b", true, false);
+        char * s4 = memoryM()->Format("n:%d, u:%u, x:%x, X:%X", 128, 128, 128, 128);
+        char * s5 = memoryM()->Format("s:%s, a:%s", "ok les filles", "Yes");
+        char * s6 = memoryM()->Format("c:%c, c:%c", 'A', 'z');
+        char * s7 = memoryM()->Format("%d%%", 1);
+
+        // Format date and time
+        char * f1 = memoryM()->FormatDateTime(specificDateTime, "%a - %b %d");
+        f1 = memoryM()->ReFormatDateTime(specificDateTime, "%Y-%m-%d", f1);
+
+        char * s8 = memoryM()->NewString("Hello World");
+        memoryM()->Free(s8); // Free one allocation
+        memoryM()->FreeMultiple(2, s1, s2);    // Free multiple allocation
+        
+        // Push/Pop memory context and free all allocation after previous Push
+        memoryM()->PushContext();
+        char * s222 = memoryM()->NewStringLen(100);
+            char* report = memoryM()->GetReport(); // Get allocation report
+            printf(report);
+        memoryM()->PopContext(); // Force to free all allocated since previous push
+
+        memoryM()->FreeAll();
+    }
+
+    // *************************************************
+    // UnitTests
+    // *************************************************
+
+    bool __UnitTests_Basic() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+        
+        bool * b1 = memoryM()->NewBool(); // Verify bool allocation
+        bool * b2 = memoryM()->NewBool();
+        assert(2 == memoryM()->GetMemoryUsed());
+        
+        int  * i1 = memoryM()->NewInt(); // Verify int allocation
+        int  * i2 = memoryM()->NewInt();
+        assert(10 == memoryM()->GetMemoryUsed());
+        
+        char * s1 = memoryM()->NewStringLen(10); // Verify string allocation
+        char * s2 = memoryM()->NewStringLen(100);
+        assert(10 + 11 + 101 == memoryM()->GetMemoryUsed());
+
+        const char * helloWorld = "Hello World"; // Verify allocation of a string with a static string
+        char * s3 = memoryM()->NewString(helloWorld);
+        assertString(helloWorld, s3);
+        assert(10 + 11 + 101 + 12 == memoryM()->GetMemoryUsed());
+        
+        int a1    = memoryM()->GetMemoryUsed(); // Verify that FreeAllocation() free the memory
+        char * s5 = memoryM()->NewString(helloWorld);
+        int a2    = memoryM()->GetMemoryUsed();
+        memoryM()->Free(s5);
+        assert(a1 == memoryM()->GetMemoryUsed());
+        
+        memoryM()->PushContext(); // Re push just in case
+        printf("Memory Report:\r\n%s", memoryM()->GetReport());
+        memoryM()->PopContext();
+
+        // test Free()
+        // Go back to Context 0 automatically pushed when the singleton is created
+        memoryM()->PopContext();
+        memoryM()->PushContext(); // Re push just in case
+
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        const char * testDataString1 = "0123456789";
+        int testDataString1Len = strlen(testDataString1) + 1;
+        char * s22 = memoryM()->NewString(testDataString1);
+        char * s33 = memoryM()->ReNewString(testDataString1, NULL);
+        assert(testDataString1Len*2 == memoryM()->GetMemoryUsed());
+        
+        assert(0 == memoryM()->FreeMultiple(2, s22, s33));
+        assert(1 == memoryM()->FreeMultiple(1, 4354543));
+        assert(00 == memoryM()->GetMemoryUsed());
+
+        return true;
+    }
+
+    bool __UnitTests_BasicDate() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        int tmLen = sizeof(struct tm);
+        struct tm * now = memoryM()->NewDate();
+        assert(sizeof(struct tm) == memoryM()->GetMemoryUsed());
+
+        struct tm * now2 = memoryM()->ReNewDate(NULL);
+        assert(sizeof(struct tm)*2 == memoryM()->GetMemoryUsed());
+
+        now2 = memoryM()->ReNewDate(now2);
+        assert(sizeof(struct tm) * 2 == memoryM()->GetMemoryUsed());
+        
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+
+        now = memoryM()->NewDate();
+        assert(sizeof(struct tm) == memoryM()->GetMemoryUsed());
+
+        // There may be are some difference between Windows And Linux
+        struct tm * codeCamp22Date = memoryM()->NewDateTime(2014, 11, 22, 1, 2, 3);
+        assertDate(codeCamp22Date, 2014, 11, 22, 1, 2, 3);
+        
+        int a = memoryM()->GetMemoryUsed();
+        assert(tmLen *2 == memoryM()->GetMemoryUsed());
+
+        char * f1 = NULL;
+        f1 = memoryM()->ReFormatDateTime(codeCamp22Date, "%Y-%m-%d", f1);
+        assertString("2014-11-22", f1);
+
+        f1 = memoryM()->ReFormatDateTime(codeCamp22Date, "%a - %b %d", f1);
+        assertString("Sat - Nov 22", f1);
+              
+        f1 = memoryM()->ReFormatDateTime(codeCamp22Date, "%X", f1);
+        assertString("01:02:03", f1);
+
+        return true;
+    }
+
+    bool __UnitTests_PushPopContext() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        const char * testDataString1 = "0123456789";
+        int testDataString1Len = strlen(testDataString1) + 1;
+
+        char *s22 = memoryM()->NewString(testDataString1);
+        assert(testDataString1Len == memoryM()->GetMemoryUsed());
+
+        bool * b1 = memoryM()->NewBool();
+        bool * b2 = memoryM()->NewBool();
+        int  * i1 = memoryM()->NewInt();
+        int  * i2 = memoryM()->NewInt();
+
+        int totalAllocated = memoryM()->GetMemoryUsed();
+        assert(21 == memoryM()->GetMemoryUsed());
+
+        memoryM()->PushContext(); // Re push just in case
+
+            char *s33 = memoryM()->ReNewString(testDataString1, NULL);
+            assert(totalAllocated + testDataString1Len == memoryM()->GetMemoryUsed());
+
+        memoryM()->PopContext();
+        assert(totalAllocated == memoryM()->GetMemoryUsed());
+
+        memoryM()->PopContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        memoryM()->PushContext();
+
+        return true;
+    }
+
+    bool __UnitTests_ReNewString() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+        
+        const char * testDataString1 = "0123456789";
+        int testDataString1Len = strlen(testDataString1) + 1;
+        const char * testDataString2 = "01234567890123456789";
+        int testDataString2Len = strlen(testDataString2) + 1;
+
+        // Test ReNewString
+        char * s33 = NULL;
+        s33 = memoryM()->ReNewString(testDataString1, s33);
+        assert(testDataString1Len == memoryM()->GetMemoryUsed());
+        assertString(testDataString1, s33);
+
+        s33 = memoryM()->ReNewString("01234567890123456789", s33);
+        assertString(testDataString2, s33);
+        int a = memoryM()->GetMemoryUsed();
+        assert(testDataString2Len == memoryM()->GetMemoryUsed());
+
+        s33 = memoryM()->ReNewString(testDataString1, s33);
+        assert(testDataString1Len == memoryM()->GetMemoryUsed());
+        assertString(testDataString1, s33);
+
+        return true;
+    }
+
+    bool __UnitTests_StringFormat() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        // Verify allocation of a string with a static string
+        const char * helloWorld = "Hello World";
+        int helloWorldLen = strlen(helloWorld)+1;
+        char * s3         = memoryM()->NewString(helloWorld);
+        assertString(helloWorld, s3);
+        assert(helloWorldLen == memoryM()->GetMemoryUsed());
+
+        // Verify Format()
+        assertString("b:true, b:false", memoryM()->Format("b:%b, b:%b", true, false));
+        assertString("n:128, u:128, x:80, X:80", memoryM()->Format("n:%d, u:%u, x:%x, X:%X", 128, 128, 128, 128));
+        assertString("s:ok les filles, a:Yes", memoryM()->Format("s:%s, a:%s", "ok les filles", "Yes"));
+        assertString("c:A, c:z", memoryM()->Format("c:%c, c:%c", 'A', 'z'));
+        assertString("1%", memoryM()->Format("%d%%", 1));
+
+        char * nullString = NULL;
+        assertString("b:", memoryM()->Format("b:%s", nullString));
+
+        assertString("-2147483648 0 ffffffff", memoryM()->Format("%d %u %x", -2147483647 - 1, 0, 0xFFFFFFFF));
+        assertString("1.500000", memoryM()->Format("%f", 1.5));
+        assertString("123456789.000000", memoryM()->Format("%f", 123456789.0));
+        assertString("ab", memoryM()->Format("a%qb")); // Unknown conversion are ignored
+        assertString("a", memoryM()->Format("a%"));
+        int used  = memoryM()->GetMemoryUsed(); // Allocate the exact size
+        char * f1 = memoryM()->Format("%s-%d", "abc", 42);
+        assertString("abc-42", f1);
+        assert(used + 7 == memoryM()->GetMemoryUsed());
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+                
+        char * s4 = NULL;
+        s4 = memoryM()->StringConcat(helloWorld, s4);
+        assert(helloWorldLen == memoryM()->GetMemoryUsed());
+        assertString(helloWorld, s4);
+        s4 = memoryM()->StringConcat(helloWorld, s4);
+        assertString("Hello WorldHello World", s4);
+        assert(helloWorldLen *2-1== memoryM()->GetMemoryUsed());
+
+        return true;
+    }
+
+    bool __UnitTests_Issue1() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+
+        time_t temp = time(NULL);  // Get a tm structure -- not re entrant
+        struct tm * tick_time = localtime(&temp);
+
+        for(int i = 0; i < 32; i++) {
+
+            char * timeBuffer = memoryM()->FormatDateTime(tick_time, "%H:%M:%S");
+            memoryM()->Free(timeBuffer);
+            printf("--  memoryM:[%d/%d]", memoryM()->GetCount(), memoryM()->GetMemoryUsed());
+        }
+        return true;
+    }
+
+    bool __UnitTests_MemoryIndex() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        int * ints[1000];
+        for (int i = 0; i < 1000; i++) {
+            ints[i] = memoryM()->NewInt();
+        }
+        assert(1000 * sizeof(int) == memoryM()->GetMemoryUsed());
+
+        for (int i = 0; i < 1000; i += 2) { // Free half, slots are re used below
+            assert(memoryM()->Free(ints[i]));
+        }
+        assert(!memoryM()->Free(ints[0])); // Already freed, no more in the index
+        assert(500 * sizeof(int) == memoryM()->GetMemoryUsed());
+
+        char * s1 = memoryM()->NewString("0123456789");
+        s1 = memoryM()->ReNewString("01234567890123456789", s1); // The new pointer is re indexed
+        s1 = memoryM()->StringConcat("0", s1);
+        assertString("012345678901234567890", s1);
+        assert(memoryM()->Free(s1));
+
+        for (int i = 1; i < 1000; i += 2) {
+            assert(memoryM()->Free(ints[i]));
+        }
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        return true;
+    }
+
+    bool __UnitTests_FreeSlots() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        int * ints[200];
+        for (int i = 0; i < 200; i++) {
+            ints[i] = memoryM()->NewInt();
+        }
+        int count = memoryM()->GetCount();
+
+        memoryM()->Free(ints[150]); // Free entries are re used lowest index first
+        memoryM()->Free(ints[70]);
+        memoryM()->Free(ints[3]);
+        ints[3]   = memoryM()->NewInt();
+        ints[70]  = memoryM()->NewInt();
+        ints[150] = memoryM()->NewInt();
+        assert(count == memoryM()->GetCount());
+        assert(ints[3]   == MemoryAllocation_Get(memoryM()->_memoryAllocation, 3).data);
+        assert(ints[70]  == MemoryAllocation_Get(memoryM()->_memoryAllocation, 70).data);
+        assert(ints[150] == MemoryAllocation_Get(memoryM()->_memoryAllocation, 150).data);
+
+        memoryM()->PushContext(); // Entries removed by a Pop are not available anymore
+            memoryM()->NewStringLen(10);
+            memoryM()->Free(memoryM()->NewInt());
+        memoryM()->PopContext();
+        assert(count == memoryM()->GetCount());
+        ints[0] = memoryM()->NewInt();
+        assert(count + 1 == memoryM()->GetCount());
+
+        return true;
+    }
+
+    bool __UnitTests_Counters() {
 
-        bool * b1                    = memoryM()->NewBool();
-        int  * i1                    = memoryM()->NewInt();
-        struct tm * now              = memoryM()->NewDate();
-        struct tm * specificDateTime = memoryM()->NewDateTime(2014, 11, 22, 1, 2, 3);
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+        assert(0 == memoryM()->GetLiveCount());
+        assert(0 == memoryM()->GetContextMemoryUsed(0));
 
-        // Allocate string
-        char * s1  = memoryM()->NewStringLen(10);    
-        char * s2  = memoryM()->NewString("Hello World");
-        char * s22 = memoryM()->StringConcat(" Joe", s2);
-        
-        memoryM()->FreeMultiple(2, s1, s2, s22);
-    
-        // Format and allocate string
-        char * s3 = memoryM()->Format("b:%b, b:%b", true, false);
-        char * s4 = memoryM()->Format("n:%d, u:%u, x:%x, X:%X", 128, 128, 128, 128);
-        char * s5 = memoryM()->Format("s:%s, a:%s", "ok les filles", "Yes");
-        char * s6 = memoryM()->Format("c:%c, c:%c", 'A', 'z');
-        char * s7 = memoryM()->Format("%d%%", 1);
+        char * s1 = memoryM()->NewString("0123456789");
+        int  * i1 = memoryM()->NewInt();
+        assert(0 == *i1);
+        assert(2 == memoryM()->GetLiveCount());
+        assert(11 + 4 == memoryM()->GetContextMemoryUsed(0));
 
-        // Format date and time
-        char * f1 = memoryM()->FormatDateTime(specificDateTime, "%a - %b %d");
-        f1 = memoryM()->ReFormatDateTime(specificDateTime, "%Y-%m-%d", f1);
+        int peak = memoryM()->GetPeakMemoryUsed();
+        assert(peak >= 11 + 4);
 
-        char * s8 = memoryM()->NewString("Hello World");
-        memoryM()->Free(s8); // Free one allocation
-        memoryM()->FreeMultiple(2, s1, s2);    // Free multiple allocation
-        
-        // Push/Pop memory context and free all allocation after previous Push
         memoryM()->PushContext();
-        char * s222 = memoryM()->NewStringLen(100);
-            char* report = memoryM()->GetReport(); // Get allocation report
-            printf(report);
-        memoryM()->PopContext(); // Force to free all allocated since previous push
+            char * s2 = memoryM()->NewStringLen(100);
+            s1 = memoryM()->StringConcat("0123456789", s1); // Owned by context 0
+            assert(21 + 4 == memoryM()->GetContextMemoryUsed(0));
+            assert(101 == memoryM()->GetContextMemoryUsed(1));
+            assert(21 + 4 + 101 == memoryM()->GetMemoryUsed());
+            assert(3 == memoryM()->GetLiveCount());
+            assert(-1 == memoryM()->GetContextMemoryUsed(2));
+
+            memoryM()->PushContext();
+                memoryM()->NewBool();
+                assert(1 == memoryM()->GetContextMemoryUsed(2));
+            memoryM()->PopContext();
+
+            memoryM()->Free(s2);
+            assert(0 == memoryM()->GetContextMemoryUsed(1));
+            memoryM()->NewStringLen(200);
+            assert(201 == memoryM()->GetContextMemoryUsed(1));
+        memoryM()->PopContext();
 
-        memoryM()->FreeAll();
+        assert(21 + 4 == memoryM()->GetMemoryUsed());
+        assert(2 == memoryM()->GetLiveCount());
+        assert(memoryM()->GetPeakMemoryUsed() >= 21 + 4 + 201);
+
+        return true;
     }
 
-    // *************************************************
-    // UnitTests
-    // *************************************************
+    bool __UnitTests_ArenaContext() {
 
-    bool __UnitTests_Basic() {
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        char * s0 = memoryM()->NewString("Hello World"); // Not in the arena
+        int count = memoryM()->GetCount();
+
+        assert(memoryM()->PushArenaContext());
+            char * s1 = memoryM()->NewString("0123456789");
+            int  * i1 = memoryM()->NewInt();
+            assert(count == memoryM()->GetCount()); // Nothing added to the registry
+            assert(12 + 11 + 4 == memoryM()->GetMemoryUsed());
+            assert(11 + 4 == memoryM()->GetContextMemoryUsed(1));
+            assert(3 == memoryM()->GetLiveCount());
+
+            assert(memoryM()->Free(i1)); // Free a single allocation in the arena
+            assert(!memoryM()->Free(i1));
+            assert(11 == memoryM()->GetContextMemoryUsed(1));
+
+            s1 = memoryM()->StringConcat("0123456789", s1);
+            assertString("01234567890123456789", s1);
+            s1 = memoryM()->ReNewString("Hello", s1);
+            assertString("Hello", s1);
+            assert(6 == memoryM()->GetContextMemoryUsed(1));
+
+            for (int i = 0; i < 1000; i++) { // Use more than one chunk
+                memoryM()->NewStringLen(32);
+            }
+            assert(6 + 1000 * 33 == memoryM()->GetContextMemoryUsed(1));
+
+            s0 = memoryM()->StringConcat("!", s0); // Still in the registry
+            assertString("Hello World!", s0);
+
+            memoryM()->PushContext(); // A nested context is not an arena
+                char * s2 = memoryM()->NewString("0123456789");
+                assertString("0123456789", s2);
+                assert(count + 1 == memoryM()->GetCount());
+            memoryM()->PopContext();
+
+        assert(memoryM()->PopContext());
+        assert(13 == memoryM()->GetMemoryUsed());
+        assert(1 == memoryM()->GetLiveCount());
+        assert(!memoryM()->Free(s1)); // The arena is released
+
+        return true;
+    }
+
+    bool __UnitTests_Slab() {
 
         memoryM()->PopContext(); // Restore memory to initialization state
         memoryM()->PushContext();
         assert(0 == memoryM()->GetMemoryUsed());
-        
-        bool * b1 = memoryM()->NewBool(); // Verify bool allocation
-        bool * b2 = memoryM()->NewBool();
-        assert(2 == memoryM()->GetMemoryUsed());
-        
-        int  * i1 = memoryM()->NewInt(); // Verify int allocation
-        int  * i2 = memoryM()->NewInt();
-        assert(10 == memoryM()->GetMemoryUsed());
-        
-        char * s1 = memoryM()->NewStringLen(10); // Verify string allocation
-        char * s2 = memoryM()->NewStringLen(100);
-        assert(10 + 11 + 101 == memoryM()->GetMemoryUsed());
 
-        char * helloWorld = "Hello World"; // Verify allocation of a string with a static string
-        char * s3 = memoryM()->NewString(helloWorld);
-        assertString(helloWorld, s3);
-        assert(10 + 11 + 101 + 12 == memoryM()->GetMemoryUsed());
-        
-        int a1    = memoryM()->GetMemoryUsed(); // Verify that FreeAllocation() free the memory
-        char * s5 = memoryM()->NewString(helloWorld);
-        int a2    = memoryM()->GetMemoryUsed();
-        memoryM()->Free(s5);
-        assert(a1 == memoryM()->GetMemoryUsed());
-        
-        memoryM()->PushContext(); // Re push just in case
-        printf("Memory Report:\r\n%s", memoryM()->GetReport());
+        int * i1 = memoryM()->NewInt();
+        int * i2 = memoryM()->NewInt();
+        assert(0 == ((size_t)i1 % sizeof(int)));
+        *i1 = 1;
+        *i2 = 2;
+
+        memoryM()->Free(i1); // A freed slot is re used first and set to 0
+        int * i3 = memoryM()->NewInt();
+        #if !defined(MEMORYM_NO_SLAB)
+            assert(i3 == i1);
+        #endif
+        assert(0 == *i3);
+        assert(2 == *i2);
+
+        struct tm * d1 = memoryM()->NewDate();
+        assert(0 == ((size_t)d1 % sizeof(int)));
+        d1 = memoryM()->ReNewDate(d1);
+
+        char * s1 = memoryM()->NewString("0123456789"); // Short strings use a slab
+        s1 = memoryM()->StringConcat("0123456789012345678901234567890123456789012345678901234567890123456789", s1); // Too big for a slab
+        assertString("01234567890123456789012345678901234567890123456789012345678901234567890123456789", s1);
+        assert(memoryM()->Free(s1));
+        assert(4 + 4 + sizeof(struct tm) == memoryM()->GetMemoryUsed());
+
+        return true;
+    }
+
+    bool __UnitTests_MemoryAllocationArray() {
+
+        MemoryAllocationArray* array = MemoryAllocation_New();
+        MemoryAllocation ma;
+        char buffer[100];
+
+        for (int i = 0; i < 100; i++) { // Grow over the initial capacity
+            ma.data = &buffer[i];
+            ma.size = i;
+            assert(MemoryAllocation_PushA(array, &ma));
+        }
+        assert(99 == MemoryAllocation_GetLength(array));
+        assert(&buffer[42] == MemoryAllocation_Get(array, 42).data);
+        assert(42 == MemoryAllocation_Get(array, 42).size);
+
+        ma.data = NULL; // The view is a copy, Set() update the entry
+        ma.size = 0;
+        assert(MemoryAllocation_Set(array, 42, &ma));
+        assert(NULL == array->data[42]);
+
+        ma = MemoryAllocation_Pop(array);
+        assert(&buffer[99] == ma.data);
+        assert(98 == MemoryAllocation_GetLength(array));
+
+        MemoryAllocation_Destructor(array);
+        return true;
+    }
+
+    unsigned long long __UnitTests_RadixKey(void* value) {
+
+        return *(unsigned long long*)value;
+    }
+
+    bool __UnitTests_RadixSort() {
+
+        DArray* array = darray_init();
+        assert(array == darray_radix_sort(array)); // Nothing to sort
+
+        int keys[]     = { 7, 0x7FFFFFFF, 0, -1, 7, (int)0x80000000, 0, 256, 0x7FFFFFFF, 255 };
+        int expected[] = { (int)0x80000000, -1, 0, 0, 7, 7, 255, 256, 0x7FFFFFFF, 0x7FFFFFFF };
+        int count      = sizeof(keys) / sizeof(keys[0]);
+        for (int i = 0; i < count; i++) {
+            darray_push(array, &keys[i]);
+        }
+        assert(array == darray_radix_sort(array));
+        for (int i = 0; i < count; i++) {
+            assert(expected[i] == *(int*)array->data[i]);
+            if (i > 0 && expected[i - 1] == expected[i]) // Stable, the duplicates keep the order of keys
+                assert(array->data[i - 1] < array->data[i]);
+        }
+
+        unsigned long long wide[] = { 0xFFFFFFFFFFFFFFFFULL, 0, 1ULL << 56, 0xFFFFFFFFFFFFFFFFULL, 0, 0xFF };
+        count       = sizeof(wide) / sizeof(wide[0]);
+        array->last = -1;
+        for (int i = 0; i < count; i++) {
+            darray_push(array, &wide[i]);
+        }
+        assert(array == darray_radix_sort_by(array, __UnitTests_RadixKey)); // All the bytes of the keys
+        assert(0 == __UnitTests_RadixKey(array->data[0]));
+        assert(0xFFFFFFFFFFFFFFFFULL == __UnitTests_RadixKey(array->data[count - 1]));
+        for (int i = 1; i < count; i++) {
+            unsigned long long previous = __UnitTests_RadixKey(array->data[i - 1]);
+            unsigned long long key      = __UnitTests_RadixKey(array->data[i]);
+            assert(previous < key || (previous == key && array->data[i - 1] < array->data[i]));
+        }
+
+        array->last = -1;
+        for (int i = count - 1; i >= 0; i--) { // By the pointers without a key
+            darray_push(array, &wide[i]);
+        }
+        assert(array == darray_radix_sort_by(array, NULL));
+        for (int i = 0; i < count; i++) {
+            assert(&wide[i] == array->data[i]);
+        }
+
+        free(array->data); // The elements are not allocated, no darray_free()
+        free(array);
+        return true;
+    }
+
+    bool __UnitTests_StringBuilder() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        char * sb = memoryM()->NewBuilder(100);
+        char * sb0 = sb;
+        assertString("", sb);
+        assert(1 == memoryM()->GetMemoryUsed()); // Only the used size is counted
+
+        sb = memoryM()->Append(sb, "Hello", -1);
+        sb = memoryM()->Append(sb, " World!!!", 6);
+        sb = memoryM()->AppendFormat(sb, " %d %s", 2014, "ok");
+        assert(sb == sb0); // In the capacity, no re allocation
+        assertString("Hello World 2014 ok", sb);
+        assert(20 == memoryM()->GetMemoryUsed());
+
+        for (int i = 0; i < 100; i++) { // Grow over the capacity
+            sb = memoryM()->Append(sb, "0123456789", -1);
+        }
+        assert(1019 == strlen(sb));
+        assert(1020 == memoryM()->GetMemoryUsed());
+
+        sb = memoryM()->Append(sb, sb, 5); // Append to itself
+        assert(0 == strcmp(sb + 1019, "Hello"));
+
+        sb = memoryM()->ToString(sb);
+        assert(1025 == memoryM()->GetMemoryUsed());
+        assert(1 == memoryM()->GetLiveCount());
+        assert(memoryM()->Free(sb));
+
+        char * s1 = memoryM()->NewString("ab"); // StringConcat uses the spare capacity of the block
+        int capacity = __getAllocationCapacity(s1);
+        char * s2 = memoryM()->StringConcat("c", s1);
+        assertString("abc", s2);
+        if (capacity >= 4)
+            assert(s1 == s2);
+        assert(4 == memoryM()->GetMemoryUsed());
+
+        s2 = memoryM()->StringConcat(s2, s2); // With itself, in place then moved
+        assertString("abcabc", s2);
+        for (int i = 0; i < 4; i++) {
+            s2 = memoryM()->StringConcat(s2, s2);
+        }
+        assert(96 == strlen(s2) && 0 == strncmp(s2 + 90, "abcabc", 7));
+        assert(97 == memoryM()->GetMemoryUsed());
+
+        sb = memoryM()->Append(NULL, "Hi", -1);
+        assertString("Hi", sb);
+
+        memoryM()->PushArenaContext(); // Builders also grow in an arena
+            char * sb2 = memoryM()->NewBuilder(0);
+            for (int i = 0; i < 10; i++) {
+                sb2 = memoryM()->AppendFormat(sb2, "%d", i);
+            }
+            assertString("0123456789", sb2);
+            assert(11 == memoryM()->GetContextMemoryUsed(1));
+        memoryM()->PopContext();
+        assert(100 == memoryM()->GetMemoryUsed());
+
+        return true;
+    }
+
+    typedef struct {
+
+        char data[MEMORYM_MAX_REPORT_SIZE * 4];
+        int  len;
+        int  calls;
+    } __UnitTestsReportBuffer;
+
+    void __UnitTests_ReportWrite(void* userData, char* data, int len) {
+
+        __UnitTestsReportBuffer* b = (__UnitTestsReportBuffer*)userData;
+        assert(b->len + len < (int)sizeof(b->data));
+        memcpy(b->data + b->len, data, len);
+        b->len += len;
+        b->data[b->len] = '\0';
+        b->calls++;
+    }
+
+    bool __UnitTests_WriteReport() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        static __UnitTestsReportBuffer b;
+        MemoryReportSink sink = MemoryReportSink_Callback(__UnitTests_ReportWrite, &b);
+        #if !defined(MEMORYM_SHARED)
+            int count = memoryM()->GetCount();
+        #endif
+
+        int * i1 = memoryM()->NewInt();
+        char * s1 = memoryM()->NewString("Hello");
+        assertString("Hello", s1);
+        memoryM()->Free(i1);
+        int used = memoryM()->GetMemoryUsed();
+        int live = memoryM()->GetLiveCount();
+
+        b.len = 0;
+        assert(memoryM()->WriteReport(&sink, MEMORYM_REPORT_TEXT));
+        assert(used == memoryM()->GetMemoryUsed()); // The report does not allocate
+        assert(live == memoryM()->GetLiveCount());
+        assert(NULL != strstr(b.data, "Used:    6, Count:"));
+
+        b.len = 0;
+        assert(memoryM()->WriteReport(&sink, MEMORYM_REPORT_CSV | MEMORYM_REPORT_LIVE_ONLY));
+        assert(b.data == strstr(b.data, "index,size,allocated,address,context,references\r\n"));
+        #if !defined(MEMORYM_SHARED) // The index of a row is its index in its shard
+            char * row = memoryM()->Format("%d,6,", count + 2);
+            assert(NULL != strstr(b.data, row));
+            memoryM()->Free(row);
+            row = memoryM()->Format("\n%d,4,", count + 1); // Free entry filtered
+            assert(NULL == strstr(b.data, row));
+            memoryM()->Free(row);
+        #endif
+
+        b.len = 0;
+        assert(memoryM()->WriteReport(&sink, MEMORYM_REPORT_JSON));
+        assert(b.data == strstr(b.data, "{\"allocations\":["));
+        assert(NULL != strstr(b.data, "],\"used\":6,\"live\":1,"));
+
+        for (int i = 0; i < 100; i++) { // Longer than the buffer, streamed in several writes
+            memoryM()->NewInt();
+        }
+        b.len   = 0;
+        b.calls = 0;
+        assert(memoryM()->WriteReport(&sink, MEMORYM_REPORT_TEXT | MEMORYM_REPORT_LIVE_ONLY));
+        assert(b.calls > 1);
+
+        char * report = memoryM()->GetReport(); // Same text
+        #if !defined(MEMORYM_SHARED) // The shards have free entries, the report may be in one of them
+            assert(0 == strcmp(report, b.data));
+        #endif
+        char * footer = strstr(report, "Used:"); // Not truncated by the row of the report
+        assert(NULL != footer && NULL != strstr(footer, "Count:") && 0 == strcmp(footer + strlen(footer) - 2, "\r\n"));
+        memoryM()->Free(report);
+
+        static char longRow[MEMORYM_MAX_REPORT_SIZE * 2];
+        static MemoryReportWriter writer;
+        memset(longRow, 'x', sizeof(longRow) - 1);
+        writer.sink = &sink;
+        writer.len  = MEMORYM_MAX_REPORT_SIZE - MEMORYM_REPORT_MAX_ROW; // Room for a row, not for a longer one
+        writer.ok   = true;
+        memset(writer.buffer, 'a', writer.len);
+        b.len = 0;
+        __reportRow(&writer, "%.300s", longRow); // Flushed then formatted again
+        assert(MEMORYM_MAX_REPORT_SIZE - MEMORYM_REPORT_MAX_ROW == b.len);
+        assert(300 == writer.len);
+        __reportRow(&writer, "%s", longRow); // Truncated to the buffer
+        assert(MEMORYM_MAX_REPORT_SIZE - 1 == writer.len);
+        __reportFlush(&writer);
+        assert(MEMORYM_MAX_REPORT_SIZE - MEMORYM_REPORT_MAX_ROW + 300 + MEMORYM_MAX_REPORT_SIZE - 1 == b.len);
+
+        return true;
+    }
+
+    bool __UnitTests_ContextGeneration() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        int * i1 = memoryM()->NewInt();
+        int * i2 = memoryM()->NewInt();
+        memoryM()->Free(i1); // Available entry below the next context
+
+        memoryM()->PushContext();
+            char * s1 = memoryM()->NewString("0123456789"); // Re use the entry of i1
+            assertString("0123456789", s1);
+            assert(11 == memoryM()->GetContextMemoryUsed(1));
+        memoryM()->PopContext();
+        assert(4 == memoryM()->GetMemoryUsed()); // s1 is freed by the Pop
+        assert(1 == memoryM()->GetLiveCount());
+
+        for (int level = 1; level <= 100; level++) { // No limit to the nesting
+            assert(memoryM()->PushContext());
+            memoryM()->NewStringLen(level);
+            assert(level + 1 == memoryM()->GetContextMemoryUsed(level));
+        }
+        assert(-1 == memoryM()->GetContextMemoryUsed(101));
+        assert(4 + 100 * 101 / 2 + 100 == memoryM()->GetMemoryUsed());
+
+        for (int level = 100; level >= 1; level--) {
+            assert(memoryM()->PopContext());
+            assert(4 + level * (level - 1) / 2 + level - 1 == memoryM()->GetMemoryUsed());
+        }
+        assert(1 == memoryM()->GetLiveCount());
+        assert(memoryM()->Free(i2));
+
+        return true;
+    }
+
+    bool __UnitTests_Clock() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        struct tm * d1 = memoryM()->NewDate();
+        assert(d1 == memoryM()->ReNewDate(d1)); // In place
+        assert(sizeof(struct tm) == memoryM()->GetMemoryUsed());
+        assert(1 == memoryM()->GetLiveCount());
+
+        // Move the cache back, now is refreshed from the minutes and seconds or localtime_r()
+        int seconds[] = { 1, 59, 61, 3599, 3601, 86400 * 400 };
+        for (int i = 0; i < (int)(sizeof(seconds) / sizeof(seconds[0])); i++) {
+
+            struct tm expected;
+            time_t now;
+            do {
+                now           = time(NULL);
+                __clock.time  = now - seconds[i];
+                __localtime(&__clock.time, &__clock.tm);
+                memoryM()->ReNewDate(d1);
+                __localtime(&now, &expected);
+            } while (now != time(NULL)); // The second changed during the test
+
+            assertDate(d1, expected.tm_year + 1900, expected.tm_mon + 1, expected.tm_mday, expected.tm_hour, expected.tm_min, expected.tm_sec);
+            assert(expected.tm_wday == d1->tm_wday);
+            assert(expected.tm_yday == d1->tm_yday);
+        }
+
+        int i1 = 1;
+        assert(NULL == memoryM()->ReNewDate((struct tm *)&i1)); // Not managed
+        assert(memoryM()->Free(d1));
+
+        return true;
+    }
+
+    bool __UnitTests_FormatDateTimeCache() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        struct tm * date = memoryM()->NewDateTime(2014, 11, 22, 1, 2, 3);
+        char * f1 = memoryM()->FormatDateTime(date, "%H:%M:%S");
+        char * f2 = memoryM()->FormatDateTime(date, "%H:%M:%S"); // From the cache
+        assertString("01:02:03", f1);
+        assertString("01:02:03", f2);
+        assert(f1 != f2);
+
+        date->tm_sec = 4;
+        assert(f1 == memoryM()->ReFormatDateTime(date, "%H:%M:%S", f1)); // Same length, in place
+        assertString("01:02:04", f1);
+        assert(f1 == memoryM()->ReFormatDateTime(date, "%H:%M", f1)); // Shorter, in place
+        assertString("01:02", f1);
+        assert(6 == __getAllocationSize(f1));
+        f1 = memoryM()->ReFormatDateTime(date, "%Y-%m-%d %H:%M:%S", f1); // Longer
+        assertString("2014-11-22 01:02:04", f1);
+
+        // Formats and texts longer than the cache are not truncated
+        const char * longFormat = "%Y-%m-%d - The quick brown fox jumps over the lazy dog - %H:%M:%S";
+        f2 = memoryM()->ReFormatDateTime(date, longFormat, f2);
+        assertString("2014-11-22 - The quick brown fox jumps over the lazy dog - 01:02:04", f2);
+        char * f3 = memoryM()->FormatDateTime(date, "%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y%Y");
+        assert(80 == strlen(f3));
+        char * f4 = memoryM()->FormatDateTime(date, "");
+        assertString("", f4);
+
+        assert(0 == memoryM()->FreeMultiple(5, date, f1, f2, f3, f4));
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        return true;
+    }
+
+    bool __UnitTests_InternString() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        char buffer[] = "Hello World";
+        char * s1 = memoryM()->InternString("Hello World");
+        char * s2 = memoryM()->InternString(buffer); // Same content, same copy
+        assert(s1 == s2);
+        assertString("Hello World", s1);
+        assert(12 == memoryM()->GetMemoryUsed());
+        assert(1 == memoryM()->GetLiveCount());
+
+        memoryM()->PushContext();
+            char * s3 = memoryM()->InternString("Hello World");
+            char * s4 = memoryM()->InternString("Hello");
+            assert(s3 == s1);
+            assert(s4 != s1);
+            assert(0 == memoryM()->GetContextMemoryUsed(1)); // Out of any context
         memoryM()->PopContext();
+        assert(2 == memoryM()->GetLiveCount()); // Not freed by the Pop
+
+        static __UnitTestsReportBuffer b;
+        MemoryReportSink sink = MemoryReportSink_Callback(__UnitTests_ReportWrite, &b);
+        b.len = 0;
+        assert(memoryM()->WriteReport(&sink, MEMORYM_REPORT_TEXT | MEMORYM_REPORT_LIVE_ONLY));
+        assert(NULL != strstr(b.data, "interned x3"));
+        assert(NULL == strstr(strstr(b.data, "interned x3") + 1, "interned x3")); // Reported once
+
+        assert(memoryM()->Free(s1));
+        assert(memoryM()->Free(s2));
+        assert(12 + 6 == memoryM()->GetMemoryUsed()); // One reference left
+        char * s5 = memoryM()->ReNewString("Bye", s3); // Releases the last reference
+        assertString("Bye", s5);
+        char * s6 = memoryM()->InternString("Hello World"); // Interned again
+        assertString("Hello World", s6);
+
+        // Copy on write, the interned string is not modified
+        char * s7 = memoryM()->InternString("Hello World");
+        s7 = memoryM()->StringConcat("!", s7);
+        assertString("Hello World!", s7);
+        assertString("Hello World", s6);
+
+        // Renewed from itself, the last reference is released after the copy
+        char * s8 = memoryM()->InternString("Interned once");
+        s8 = memoryM()->ReNewString(s8, s8);
+        assertString("Interned once", s8);
+        char * s9  = memoryM()->InternString("Interned once");
+        char * s10 = memoryM()->InternString("Interned once");
+        s10 = memoryM()->ReNewString(s10 + 9, s10); // The other reference is kept
+        assertString("once", s10);
+        assertString("Interned once", s9);
+
+        // Many strings, the table grows
+        char * strings[1000];
+        for (int i = 0; i < 1000; i++) {
+            char * f   = memoryM()->Format("string %d", i % 500);
+            strings[i] = memoryM()->InternString(f);
+            memoryM()->Free(f);
+        }
+        for (int i = 0; i < 500; i++) {
+            assert(strings[i] == strings[i + 500]);
+        }
+        assert(0 == memoryM()->FreeArray((void**)strings, 1000));
+        assert(0 == memoryM()->FreeMultiple(7, s4, s5, s6, s7, s8, s9, s10));
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        return true;
+    }
+
+    bool __UnitTests_InlineString() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        char * s1 = memoryM()->NewString("1");
+        assert(__allocOnlyCapacity(2) == __getAllocationCapacity(s1)); // Not padded until it is built on
+        assert(2 == memoryM()->GetMemoryUsed()); // The capacity is not counted as used
+
+        char * s2 = s1;
+        for (int i = 10; i < 100000; i *= 10) { // Re written in place, once moved to the inline capacity
+            char * f     = memoryM()->Format("%d", i);
+            int capacity = __getAllocationCapacity(s2);
+            s1           = s2;
+            s2           = memoryM()->ReNewString(f, s2);
+            assert(s1 == s2 || (int)strlen(f) >= capacity);
+            assert(s1 == s2 || MEMORYM_INLINE_STRING_SIZE <= __getAllocationCapacity(s2));
+            assertString(f, s2);
+            memoryM()->Free(f);
+        }
+        int capacity = __getAllocationCapacity(s2);
+        s1 = s2;
+        s2 = memoryM()->StringConcat("0123456789", s2);
+        assertString("100000123456789", s2);
+        assert(s1 == s2 || 16 > capacity);
+        assert(16 == memoryM()->GetMemoryUsed());
+        capacity = __getAllocationCapacity(s2);
+        s1 = s2;
+        s2 = memoryM()->ReNewString(s2 + 1, s2); // Overlapping
+        assertString("00000123456789", s2);
+        assert(s1 == s2 || 15 > capacity);
+
+        s2 = memoryM()->StringConcat("0123456789", s2); // Outgrows the inline capacity
+        assertString("000001234567890123456789", s2);
+        assert(25 == memoryM()->GetMemoryUsed());
+        s2 = memoryM()->ReNewString("a", s2);
+        assertString("a", s2);
+        assert(2 == memoryM()->GetMemoryUsed());
+        assert(memoryM()->Free(s2));
+
+        return true;
+    }
+
+    bool __UnitTests_Uninit() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        char * s1 = memoryM()->NewStringLenUninit(10);
+        assert('\0' == s1[10]);
+        assert(11 == memoryM()->GetMemoryUsed());
+        memcpy(s1, "0123456789", 10);
+        assertString("0123456789", s1);
+
+        int size  = 1024 * 1024; // calloc()
+        char * s2 = memoryM()->NewStringLen(size);
+        for (int i = 0; i <= size; i++) {
+            assert('\0' == s2[i]);
+        }
+        char * s3 = memoryM()->NewStringLenUninit(size);
+        memset(s3, 'a', size);
+        assert(size == (int)strlen(s3));
+
+        // The byte added by a re allocation keeping the content are still set to 0
+        s1 = memoryM()->StringConcat("abcdefghijklmnopqrstuvwxyz", s1);
+        assertString("0123456789abcdefghijklmnopqrstuvwxyz", s1);
+        assert(memoryM()->Free(s3));
+        s3 = memoryM()->NewBuilder(1000);
+        assertString("", s3);
+        s3 = memoryM()->Append(s3, "Hello", -1);
+        assertString("Hello", s3);
+
+        assert(0 == memoryM()->FreeMultiple(3, s1, s2, s3));
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        return true;
+    }
+
+    bool __UnitTests_Sites() {
+
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
+
+        char * strings[10];
+        #if defined(MEMORYM_SITE_STATS)
+            int line = __LINE__ + 3;
+        #endif
+        for (int i = 0; i < 10; i++) {
+            strings[i] = MM_NEW_STRING("Hello"); // Without MEMORYM_SITE_STATS only the call
+        }
+        int * i1 = MM_NEW_INT();
+        char * s1 = memoryM()->NewString("Not counted");
+        assert(NULL != i1 && 0 == strcmp("Not counted", s1));
+        for (int i = 0; i < 4; i++) {
+            memoryM()->Free(strings[i]);
+        }
+        char * report = memoryM()->GetSiteReport(-1);
+        assert(0 == strncmp(report, "Sites:", 6));
+
+        #if defined(MEMORYM_SITE_STATS)
+            MemorySite* site = NULL;
+            for (int i = 0; i < MEMORYM_SITE_COUNT; i++) {
+                if (__sites[i].file != NULL && __sites[i].line == line)
+                    site = &__sites[i];
+            }
+            assert(site != NULL);
+            assert(0 == strcmp("__UnitTests_Sites", site->function));
+            long long count = site->count; // The test may run more than once
+            assert(count >= 10 && count % 10 == 0);
+            assert(count * 6 == site->bytes);
+            assert(6 * 6 == site->liveBytes);
+            assert(count - 6 == site->frees);
+            assert(count == site->histogram[0]);
+
+            char row[256];
+            snprintf(row, sizeof(row), "%lld %12lld %12d %10lld  MemoryM.cpp:%d __UnitTests_Sites\r\n     sizes 1-8:%lld", 
+                count, count * 6, 36, count - 6, line, count);
+            assert(NULL != strstr(report, row));
+            memoryM()->Free(report);
+
+            report = memoryM()->GetSiteReport(1); // The hottest only
+            assert(NULL != strstr(report, "Sites:    1"));
+            assert(NULL == strstr(report, "sizes 1-8:1\r\n")); // Not the site of MM_NEW_INT()
+
+            s1 = MM_RENEW_STRING("Counted now", s1); // Moved to the site
+            char * f1 = MM_FORMAT("%s%d", "x", 1);
+            assert(0 == strcmp("x1", f1));
+
+            // The inner macro restores the site of the outer one, both on the same line
+            line = __LINE__ + 1;
+            char * nested = MM_NEW_STRING(MM_FORMAT("%d", 42));
+            assert(0 == strcmp("42", nested));
+            site = NULL;
+            for (int i = 0; i < MEMORYM_SITE_COUNT; i++) {
+                if (__sites[i].file != NULL && __sites[i].line == line)
+                    site = &__sites[i];
+            }
+            assert(site != NULL && site->count >= 2 && site->count % 2 == 0);
+        #endif
+        memoryM()->Free(report);
+
+        return true;
+    }
+
+    void __UnitTests_PrefixWrite(void* userData, char* data, int len) {
+
+        __UnitTestsReportBuffer* b = (__UnitTestsReportBuffer*)userData; // Keep the beginning of a long stream
+        int room = (int)sizeof(b->data) - 1 - b->len;
+        if (len > room)
+            len = room;
+        memcpy(b->data + b->len, data, len);
+        b->len += len;
+        b->data[b->len] = '\0';
+        b->calls++;
+    }
 
-        // test Free()
-        // Go back to Context 0 automatically pushed when the singleton is created
-        memoryM()->PopContext();
-        memoryM()->PushContext(); // Re push just in case
+    bool __UnitTests_HeapProfile() {
 
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
         assert(0 == memoryM()->GetMemoryUsed());
 
-        char * testDataString1 = "0123456789";
-        int testDataString1Len = strlen(testDataString1) + 1;
-        char * s22 = memoryM()->NewString(testDataString1);
-        char * s33 = memoryM()->ReNewString(testDataString1, NULL);
-        assert(testDataString1Len*2 == memoryM()->GetMemoryUsed());
-        
-        assert(0 == memoryM()->FreeMultiple(2, s22, s33));
-        assert(1 == memoryM()->FreeMultiple(1, 4354543));
-        assert(00 == memoryM()->GetMemoryUsed());
+        static __UnitTestsReportBuffer b;
+        MemoryReportSink sink = MemoryReportSink_Callback(__UnitTests_PrefixWrite, &b);
+
+        #if defined(MEMORYM_HEAP_PROFILE)
+            int rate = memoryM()->SetSampleRate(1); // Sample every allocation
+            int live = __samplesLive;
+            char * s1 = memoryM()->NewStringLen(39);
+            char * s2 = memoryM()->NewString("Hello");
+            int  * i1 = memoryM()->NewInt();
+            assert(live + 3 == __samplesLive);
+            memoryM()->Free(s2);
+            assert(live + 2 == __samplesLive);
+
+            b.len = 0;
+            assert(memoryM()->WriteHeapProfile(&sink, MEMORYM_PROFILE_PPROF));
+            assert(0 == strncmp(b.data, "heap profile: ", 14));
+            if (live == 0)
+                assert(0 == strncmp(b.data, "heap profile:      2:       44 [     2:       44] @ heap_v2/1\n", 62));
+            assert(NULL != strstr(b.data, "\n     1:       40 [     1:       40] @ 0x"));
+            assert(NULL != strstr(b.data, "\n     1:        4 [     1:        4] @ 0x"));
+            assert(NULL != strstr(b.data, "\nMAPPED_LIBRARIES:\n"));
+
+            b.len = 0;
+            assert(memoryM()->WriteHeapProfile(&sink, MEMORYM_PROFILE_FOLDED));
+            assert(NULL != strstr(b.data, " 40\n")); // Sampled at a rate of 1, the estimate is the size
+            assert(NULL != strstr(b.data, " 4\n"));
+
+            memoryM()->Free(s1);
+            memoryM()->Free(i1);
+            assert(live == __samplesLive);
+            assert(1 == memoryM()->SetSampleRate(rate));
+        #else
+            assert(!memoryM()->WriteHeapProfile(&sink, MEMORYM_PROFILE_PPROF));
+            assert(0 == memoryM()->SetSampleRate(1));
+        #endif
 
         return true;
     }
 
-    bool __UnitTests_BasicDate() {
+    bool __UnitTests_Stats() {
 
         memoryM()->PopContext(); // Restore memory to initialization state
         memoryM()->PushContext();
         assert(0 == memoryM()->GetMemoryUsed());
 
-        int tmLen = sizeof(struct tm);
-        struct tm * now = memoryM()->NewDate();
-        assert(sizeof(struct tm) == memoryM()->GetMemoryUsed());
+        static MemoryStats stats;
+        memoryM()->GetStats(&stats);
+        int level = stats.contextLevel;
+        assert(level >= 0);
+        assert(0 == stats.contextMemoryUsed[level]);
+        assert(0 == stats.contextPeakMemoryUsed[level]);
 
-        struct tm * now2 = memoryM()->ReNewDate(NULL);
-        assert(sizeof(struct tm)*2 == memoryM()->GetMemoryUsed());
+        char * s1 = memoryM()->NewStringLen(99);
+        int  * i1 = memoryM()->NewInt();
+        assert(i1 != NULL);
+        memoryM()->Free(s1);
+        memoryM()->GetStats(&stats);
+        assert(4 == stats.contextMemoryUsed[level]);
+        assert(104 == stats.contextPeakMemoryUsed[level]); // The peak stays after the free
+        assert(stats.memoryUsed == memoryM()->GetMemoryUsed());
+        assert(stats.liveCount == memoryM()->GetLiveCount());
+        assert(stats.peakMemoryUsed == memoryM()->GetPeakMemoryUsed());
+        assert(stats.peakMemoryUsed >= stats.memoryUsed + 100);
+        assert(stats.peakLiveCount >= stats.liveCount + 1);
 
-        now2 = memoryM()->ReNewDate(now2);
-        assert(sizeof(struct tm) * 2 == memoryM()->GetMemoryUsed());
-        
-        memoryM()->PopContext(); // Restore memory to initialization state
         memoryM()->PushContext();
+            char * s2 = memoryM()->NewStringLen(49);
+            memoryM()->GetStats(&stats);
+            assert(level + 1 == stats.contextLevel);
+            assert(50 == stats.contextPeakMemoryUsed[level + 1]);
+            assert(104 == stats.contextPeakMemoryUsed[level]); // Only the allocations of the context
+            for (int i = 0; i < 8; i++) { // One string at a time, whatever the shard of each one
+                memoryM()->Free(s2);
+                s2 = memoryM()->NewStringLen(49);
+            }
+            memoryM()->GetStats(&stats);
+            assert(50 == stats.contextPeakMemoryUsed[level + 1]);
+        memoryM()->PopContext();
+        memoryM()->PushContext();
+            memoryM()->GetStats(&stats);
+            assert(0 == stats.contextPeakMemoryUsed[level + 1]); // A new context
+        memoryM()->PopContext();
 
-        now = memoryM()->NewDate();
-        assert(sizeof(struct tm) == memoryM()->GetMemoryUsed());
+        #if MEMORYM_TIMELINE_SIZE > 0
+            for (int i = 0; i < MEMORYM_TIMELINE_SIZE * MEMORYM_TIMELINE_PERIOD; i++) {
+                memoryM()->NewInt();
+            }
+            memoryM()->GetStats(&stats);
+            assert(MEMORYM_TIMELINE_SIZE == stats.timelineCount); // The ring is full
+            for (int i = 1; i < stats.timelineCount; i++) {
+                assert(stats.timeline[i].time >= stats.timeline[i - 1].time);
+                assert(stats.timeline[i].memoryUsed > stats.timeline[i - 1].memoryUsed); // Only NewInt()
+                assert(stats.timeline[i].liveCount == stats.timeline[i - 1].liveCount + MEMORYM_TIMELINE_PERIOD);
+            }
+            assert(stats.timeline[stats.timelineCount - 1].memoryUsed <= stats.memoryUsed);
+        #else
+            assert(0 == stats.timelineCount);
+        #endif
 
-        // There may be are some difference between Windows And Linux
-        struct tm * codeCamp22Date = memoryM()->NewDateTime(2014, 11, 22, 1, 2, 3);
-        assertDate(codeCamp22Date, 2014, 11, 22, 1, 2, 3);
-        
-        int a = memoryM()->GetMemoryUsed();
-        assert(tmLen *2 == memoryM()->GetMemoryUsed());
+        return true;
+    }
 
-        char * f1 = NULL;
-        f1 = memoryM()->ReFormatDateTime(codeCamp22Date, "%Y-%m-%d", f1);
-        assertString("2014-11-22", f1);
+    //////////////////////////////////////////////////////////////////
+    /// __UnitTests_PoolExhausted
+    /// 
+    /// With MemoryM in a pool, fill the pool with large strings, free one and fill 
+    /// its place with small strings through the Api, then free them all, 3 times. 
+    /// Every byte freed must be available again
+    void __UnitTests_PoolExhausted() {
+
+        static char* strings[65536];
+        static MemoryStats stats;
+        size_t freeBytes[3];
+        int    larges[3];
+        int    smalls[3];
+        int    rate = memoryM()->SetSampleRate(0x7FFFFFFF); // The table of the samples would grow at random
+
+        // Grow the registry first with strings larger than the slab classes, so the 
+        // small strings are limited by the pool only
+        int n = 0;
+        while (n < 32768 && (strings[n] = memoryM()->NewStringLen(100)) != NULL) {
+            n++;
+        }
+        for (int i = 0; i < n; i++) {
+            memoryM()->Free(strings[i]);
+        }
+        memoryM()->GetStats(&stats);
+        size_t initialFree = stats.poolFree;
 
-        f1 = memoryM()->ReFormatDateTime(codeCamp22Date, "%a - %b %d", f1);
-        assertString("Sat - Nov 22", f1);
-              
-        f1 = memoryM()->ReFormatDateTime(codeCamp22Date, "%X", f1);
-        assertString("01:02:03", f1);
+        for (int round = 0; round < 3; round++) {
 
-        return true;
-    }
+            int large = 0;
+            while ((strings[large] = memoryM()->NewStringLen(64 * 1024)) != NULL) {
+                large++;
+                assert(large < 32768);
+            }
+            assert(large > 0);
+            memoryM()->Free(strings[--large]);
 
-    bool __UnitTests_PushPopContext() {
+            n = large;
+            while ((strings[n] = memoryM()->NewString("small")) != NULL) {
+                n++;
+                assert(n < 65536);
+            }
+            memoryM()->GetStats(&stats);
+            assert(stats.poolFailures > 0 && stats.liveCount == n);
+
+            for (int i = 0; i < n; i++) {
+                memoryM()->Free(strings[i]);
+            }
+            memoryM()->GetStats(&stats);
+            assert(stats.liveCount == 0);
+            larges[round]    = large;
+            smalls[round]    = n - large;
+            freeBytes[round] = stats.poolFree;
+        }
+        for (int round = 0; round < 3; round++) {
+            assert(freeBytes[round] == initialFree);
+            assert(larges[round] == larges[0] && smalls[round] == smalls[0]);
+        }
+        char* s = memoryM()->NewString("again");
+        assert(s != NULL);
+        memoryM()->Free(s);
+        memoryM()->SetSampleRate(rate);
+    }
+    bool __UnitTests_Pool() {
 
         memoryM()->PopContext(); // Restore memory to initialization state
         memoryM()->PushContext();
         assert(0 == memoryM()->GetMemoryUsed());
 
-        char * testDataString1 = "0123456789";
-        int testDataString1Len = strlen(testDataString1) + 1;
-
-        char *s22 = memoryM()->NewString(testDataString1);
-        assert(testDataString1Len == memoryM()->GetMemoryUsed());
+        static char buffer[64 * 1024];
+        assert(!memoryM_InitWithPool(buffer, sizeof(buffer))); // MemoryM is already initialized
+
+        // The allocator on its own buffer
+        MemoryPool* pool = __poolInit(buffer + 1, sizeof(buffer) - 1); // Aligned by the pool
+        size_t size      = pool->size;
+        assert(pool->freeBytes == size && __poolLargestFree(pool) == size);
+
+        char* a = (char*)__poolAlloc(pool, 100);
+        char* b = (char*)__poolAlloc(pool, 1000);
+        char* c = (char*)__poolAlloc(pool, 1);
+        assert(a != NULL && b != NULL && c != NULL);
+        assert(((size_t)a & (MEMORYM_POOL_ALIGN - 1)) == 0 && ((size_t)c & (MEMORYM_POOL_ALIGN - 1)) == 0);
+        memset(a, 'a', 100);
+        memset(b, 'b', 1000);
+        c[0] = 'c';
+        assert(pool->freeBytes < size - 1100);
+
+        __poolFree(pool, b); // Merged with the next and the previous free blocks
+        __poolFree(pool, c);
+        __poolFree(pool, a);
+        assert(pool->freeBytes == size && __poolLargestFree(pool) == size);
+
+        // Exhausted, then fragmented
+        static void* blocks[1024];
+        int n = 0;
+        while ((blocks[n] = __poolAlloc(pool, 256)) != NULL) {
+            n++;
+        }
+        assert(n > 200 && n < 1024);
+        assert(__poolAlloc(pool, 1) == NULL);
+        for (int i = 0; i < n - 1; i += 2) { // The last block may have kept the end of the pool
+            __poolFree(pool, blocks[i]);
+        }
+        assert(__poolLargestFree(pool) == 256);
+        assert(__poolAlloc(pool, 257) == NULL); // Enough free byte, no block large enough
+        assert(1.0 - (double)__poolLargestFree(pool) / pool->freeBytes > 0.9);
+        for (int i = 1; i < n; i++) {
+            if (i % 2 == 1 || i == n - 1)
+                __poolFree(pool, blocks[i]);
+        }
+        assert(pool->freeBytes == size && __poolLargestFree(pool) == size);
+
+        // Re allocation, in place in the next free block or moved
+        char* r = (char*)__poolAlloc(pool, 64);
+        strcpy(r, "pool");
+        assert(__poolRealloc(pool, r, 4096) == r);
+        assert(__poolRealloc(pool, r, 32) == r);
+        char* guard = (char*)__poolAlloc(pool, 64);
+        char* moved = (char*)__poolRealloc(pool, r, 1024);
+        assert(moved != r && strcmp(moved, "pool") == 0);
+        assert(__poolRealloc(pool, moved, size * 2) == NULL); // Kept
+        assert(strcmp(moved, "pool") == 0);
+        __poolFree(pool, guard);
+        __poolFree(pool, moved);
+        assert(pool->freeBytes == size && __poolLargestFree(pool) == size);
+
+        // Aligned, the gap in front of the block is given back to the pool
+        char* line = (char*)__poolAllocAligned(pool, 100, 64);
+        char* page = (char*)__poolAllocAligned(pool, 100, 4096);
+        assert(line != NULL && ((size_t)line & 63) == 0);
+        assert(page != NULL && ((size_t)page & 4095) == 0);
+        assert(pool->freeBytes > size - 4096);
+        __poolFree(pool, page);
+        __poolFree(pool, line);
+        assert(pool->freeBytes == size && __poolLargestFree(pool) == size);
+
+        if (__backendPool() == NULL) { // The counters of MemoryM without pool
+            static MemoryStats stats;
+            memoryM()->GetStats(&stats);
+            assert(stats.poolSize == 0 && stats.poolFailures == 0 && stats.poolFragmentation == 0);
+        }
+        else {
+            __UnitTests_PoolExhausted();
+        }
+        return true;
+    }
+    bool __UnitTests_Backend() {
 
-        bool * b1 = memoryM()->NewBool();
-        bool * b2 = memoryM()->NewBool();
-        int  * i1 = memoryM()->NewInt();
-        int  * i2 = memoryM()->NewInt();
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
 
-        int totalAllocated = memoryM()->GetMemoryUsed();
-        assert(21 == memoryM()->GetMemoryUsed());
+        MemoryBackend backend = MemoryBackend_Libc();
+        assert(!memoryM_InitWithBackend(&backend)); // MemoryM is already initialized
+
+        // The adapters called directly, the free gets the size and the alignment of the allocation
+        MemoryBackend backends[2] = { MemoryBackend_Libc(), MemoryBackend_Sized() };
+        for (int i = 0; i < 2; i++) {
+            MemoryBackend* b = &backends[i];
+
+            char* d = (char*)b->Alloc(b->context, 100, MEMORYM_BACKEND_ALIGN);
+            assert(d != NULL && ((size_t)d & (MEMORYM_BACKEND_ALIGN - 1)) == 0);
+            strcpy(d, "backend");
+            d = (char*)b->Realloc(b->context, d, 100, 10000);
+            assert(d != NULL && strcmp(d, "backend") == 0);
+            b->Free(b->context, d, 10000, MEMORYM_BACKEND_ALIGN);
+
+            char* line = (char*)b->Alloc(b->context, 100, 64); // Rounded to the alignment by Sized
+            assert(line != NULL && ((size_t)line & 63) == 0);
+            memset(line, 'l', 100);
+            b->Free(b->context, line, 100, 64);
+
+            char* zero = (char*)b->AllocZero(b->context, 1000);
+            assert(zero != NULL && zero[0] == 0 && zero[999] == 0);
+            b->Free(b->context, zero, 1000, MEMORYM_BACKEND_ALIGN);
+        }
 
-        memoryM()->PushContext(); // Re push just in case
+        // The pool adapter, NULL functions when the buffer can't hold a pool
+        static char buffer[64 * 1024];
+        backend = MemoryBackend_Pool(buffer, MEMORYM_POOL_MIN_SIZE - 1);
+        assert(backend.Alloc == NULL && backend.Free == NULL);
+        assert(!memoryM_InitWithBackend(&backend));
+        backend = MemoryBackend_Pool(buffer, sizeof(buffer));
+        assert(backend.Alloc != NULL && backend.AllocZero == NULL);
+
+        MemoryPool* pool = (MemoryPool*)backend.context;
+        size_t size      = pool->freeBytes;
+        char* line       = (char*)backend.Alloc(backend.context, 100, 64);
+        assert(line != NULL && ((size_t)line & 63) == 0);
+        assert(backend.Alloc(backend.context, sizeof(buffer), MEMORYM_BACKEND_ALIGN) == NULL);
+        assert(pool->failures == 1);
+        backend.Free(backend.context, line, 100, 64);
+        assert(pool->freeBytes == size);
+        return true;
+    }
+    bool __UnitTests_Batch() {
 
-            char *s33 = memoryM()->ReNewString(testDataString1, NULL);
-            assert(totalAllocated + testDataString1Len == memoryM()->GetMemoryUsed());
+        memoryM()->PopContext(); // Restore memory to initialization state
+        memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
 
-        memoryM()->PopContext();
-        assert(totalAllocated == memoryM()->GetMemoryUsed());
+        int   sizes[1000];
+        void* data[1000];
+        int   total = 0;
+        for (int i = 0; i < 1000; i++) {
+            sizes[i] = 1 + i % 100;
+            total   += sizes[i];
+        }
+        assert(data == memoryM()->NewMany(sizes, 1000, data));
+        assert(1000 == memoryM()->GetLiveCount());
+        assert(total == memoryM()->GetMemoryUsed());
+        for (int i = 0; i < 1000; i++) {
+            assert(sizes[i] == __getAllocationSize(data[i]));
+            assert(0 == ((char*)data[i])[sizes[i] - 1]);
+        }
 
-        memoryM()->PopContext();
+        memoryM()->Free(data[11]);
+        data[11] = NULL; // Ignored
+        memoryM()->Free(data[10]);
+        assert(1 == memoryM()->FreeArray(data, 20)); // data[10] is already freed
+        assert(980 == memoryM()->GetLiveCount());
+        assert(0 == memoryM()->FreeArray(data + 20, 980));
         assert(0 == memoryM()->GetMemoryUsed());
 
+        // The registry grows once and the entries freed are re used
+        memoryM()->NewMany(sizes, 1000, data);
+        assert(0 == memoryM()->FreeArray(data + 500, 500));
         memoryM()->PushContext();
+            memoryM()->NewMany(sizes, 500, data + 500); // Re use the entries of the second half
+            assert(1000 == memoryM()->GetLiveCount());
+        memoryM()->PopContext();
+        assert(500 == memoryM()->GetLiveCount());
+        assert(0 == memoryM()->FreeArray(data, 500));
+
+        char * s1 = memoryM()->NewString("a");
+        char * s2 = memoryM()->NewString("b");
+        assert(0 == memoryM()->FreeMultiple(3, s1, NULL, s2));
+        assert(0 == memoryM()->GetLiveCount());
+
+        assert(data == memoryM()->NewMany(sizes, 0, data));
+        assert(0 == memoryM()->FreeArray(data, 0));
 
         return true;
     }
 
-    bool __UnitTests_ReNewString() {
+    #if defined(MEMORYM_THREAD_LOCAL)
 
-        memoryM()->PopContext(); // Restore memory to initialization state
-        memoryM()->PushContext();
-        assert(0 == memoryM()->GetMemoryUsed());
-        
-        char * testDataString1 = "0123456789";
-        int testDataString1Len = strlen(testDataString1) + 1;
-        char * testDataString2 = "01234567890123456789";
-        int testDataString2Len = strlen(testDataString2) + 1;
+    MemoryManager* __UnitTests_MainMemoryM;
+    char*          __UnitTests_MainString;
 
-        // Test ReNewString
-        char * s33 = NULL;
-        s33 = memoryM()->ReNewString(testDataString1, s33);
-        assert(testDataString1Len == memoryM()->GetMemoryUsed());
-        assertString(testDataString1, s33);
+    void __UnitTests_ThreadLocalThread() {
 
-        s33 = memoryM()->ReNewString("01234567890123456789", s33);
-        assertString(testDataString2, s33);
-        int a = memoryM()->GetMemoryUsed();
-        assert(testDataString2Len == memoryM()->GetMemoryUsed());
+        assert(memoryM() != __UnitTests_MainMemoryM); // Own manager, initialized on first use
+        assert(0 == memoryM()->GetLiveCount());
 
-        s33 = memoryM()->ReNewString(testDataString1, s33);
-        assert(testDataString1Len == memoryM()->GetMemoryUsed());
-        assertString(testDataString1, s33);
+        char * s1 = memoryM()->NewString("Thread");
+        assert(1 == memoryM()->GetLiveCount());
+        assert(memoryM()->Free(__UnitTests_MainString)); // Queued to the main thread
+        assert(!memoryM()->Free(__UnitTests_MainString)); // Only once
+        assert(1 == memoryM()->GetLiveCount());
+        assert(memoryM()->Free(s1));
 
-        return true;
+        memoryM()->FreeAll();
     }
 
-    bool __UnitTests_StringFormat() {
+    bool __UnitTests_ThreadLocal() {
 
         memoryM()->PopContext(); // Restore memory to initialization state
         memoryM()->PushContext();
         assert(0 == memoryM()->GetMemoryUsed());
 
-        // Verify allocation of a string with a static string
-        char * helloWorld = "Hello World";
-        int helloWorldLen = strlen(helloWorld)+1;
-        char * s3         = memoryM()->NewString(helloWorld);
-        assertString(helloWorld, s3);
-        assert(helloWorldLen == memoryM()->GetMemoryUsed());
+        __UnitTests_MainMemoryM = memoryM();
+        __UnitTests_MainString  = memoryM()->NewString("Main");
+        memoryM()->PushArenaContext();
+        char * s1 = memoryM()->NewString("Arena");
+        assert(2 == memoryM()->GetLiveCount());
 
-        // Verify Format()
-        assertString("b:true, b:false", memoryM()->Format("b:%b, b:%b", true, false));
-        assertString("n:128, u:128, x:80, X:80", memoryM()->Format("n:%d, u:%u, x:%x, X:%X", 128, 128, 128, 128));
-        assertString("s:ok les filles, a:Yes", memoryM()->Format("s:%s, a:%s", "ok les filles", "Yes"));
-        assertString("c:A, c:z", memoryM()->Format("c:%c, c:%c", 'A', 'z'));
-        assertString("1%", memoryM()->Format("%d%%", 1));
+        std::thread thread(__UnitTests_ThreadLocalThread);
+        thread.join();
 
-        char * nullString = NULL;
-        assertString("b:", memoryM()->Format("b:%s", nullString));
+        assert(2 == memoryM()->GetLiveCount()); // Not drained yet
+        assert(memoryM()->Free(s1));             // Drain the queue first
+        assert(0 == memoryM()->GetLiveCount());
 
-        memoryM()->PopContext(); // Restore memory to initialization state
-        memoryM()->PushContext();
+        static char unmanaged[64]; // Its header is readable but not written by MemoryM
+        assert(!memoryM()->Free(unmanaged + 32));
+        memoryM()->PopContext();
         assert(0 == memoryM()->GetMemoryUsed());
-                
-        char * s4 = NULL;
-        s4 = memoryM()->StringConcat(helloWorld, s4);
-        assert(helloWorldLen == memoryM()->GetMemoryUsed());
-        assertString(helloWorld, s4);
-        s4 = memoryM()->StringConcat(helloWorld, s4);
-        assertString("Hello WorldHello World", s4);
-        assert(helloWorldLen *2-1== memoryM()->GetMemoryUsed());
 
         return true;
     }
 
-    bool __UnitTests_Issue1() {
+    #endif
+
+    #if defined(MEMORYM_SHARED)
+
+    char* __UnitTests_SharedStrings[4][100];
+
+    void __UnitTests_SharedThread(int id) {
+
+        for (int i = 0; i < 100; i++) {
+            __UnitTests_SharedStrings[id][i] = memoryM()->Format("%d-%d", id, i);
+        }
+    }
+
+    bool __UnitTests_Shared() {
 
         memoryM()->PopContext(); // Restore memory to initialization state
         memoryM()->PushContext();
+        assert(0 == memoryM()->GetMemoryUsed());
 
-        time_t temp = time(NULL);  // Get a tm structure -- not re entrant
-        struct tm * tick_time = localtime(&temp);
+        std::thread threads[4]; // Allocated by workers, freed by this thread
+        for (int t = 0; t < 4; t++) {
+            threads[t] = std::thread(__UnitTests_SharedThread, t);
+        }
+        for (int t = 0; t < 4; t++) {
+            threads[t].join();
+        }
+        assert(400 == memoryM()->GetLiveCount());
+        assert(memoryM()->GetCount() >= 399);
+
+        for (int t = 0; t < 4; t++) {
+            for (int i = 0; i < 100; i++) {
+                char * expected = memoryM()->Format("%d-%d", t, i);
+                assertString(expected, __UnitTests_SharedStrings[t][i]);
+                assert(memoryM()->Free(expected));
+                assert(memoryM()->Free(__UnitTests_SharedStrings[t][i]));
+            }
+        }
+        assert(0 == memoryM()->GetLiveCount());
+        assert(0 == memoryM()->GetMemoryUsed());
 
-        for(int i = 0; i < 32; i++) {
+        char * s1 = memoryM()->NewString("Hello");
+        memoryM()->PushContext();
+            s1 = memoryM()->StringConcat(" World", s1); // Stays in its shard and context
+        memoryM()->PopContext();
+        assertString("Hello World", s1);
+        assert(12 == memoryM()->GetContextMemoryUsed(0));
 
-            char * timeBuffer = memoryM()->FormatDateTime(tick_time, "%H:%M:%S");
-            memoryM()->Free(timeBuffer);
-            printf("--  memoryM:[%d/%d]", memoryM()->GetCount(), memoryM()->GetMemoryUsed());
+        for (int i = 0; i < 100; i++) { // Moved to pointers of the other shards
+            s1 = memoryM()->StringConcat("!", s1);
         }
+        assert(112 == __getAllocationSize(s1));
+        int i1 = 1;
+        assert(!memoryM()->Free(&i1)); // Not in any shard
+        assert(memoryM()->Free(s1));
+        assert(!memoryM()->Free(s1));
+        assert(0 == memoryM()->GetLiveCount());
+
         return true;
     }
 
+    #endif
+
     //////////////////////////////////////////////////////////////////
     /// __UnitTests
     bool __UnitTests() {
@@ -777,50 +5290,310 @@ char* __reFormatDateTime(struct tm *date, char* format, char * previousAllocatio
         __UnitTests_StringFormat();
         __UnitTests_BasicDate();
         __UnitTests_Issue1();
+        __UnitTests_MemoryIndex();
+        #if !defined(MEMORYM_SHARED) // Tests the entries of a single registry
+            __UnitTests_FreeSlots();
+        #endif
+        __UnitTests_Counters();
+        #if !defined(MEMORYM_SHARED) // No arena in a shared memory manager
+            __UnitTests_ArenaContext();
+        #endif
+        __UnitTests_Slab();
+        __UnitTests_MemoryAllocationArray();
+        __UnitTests_RadixSort();
+        __UnitTests_StringBuilder();
+        __UnitTests_WriteReport();
+        __UnitTests_ContextGeneration();
+        __UnitTests_Batch();
+        __UnitTests_Clock();
+        __UnitTests_FormatDateTimeCache();
+        __UnitTests_InternString();
+        __UnitTests_InlineString();
+        __UnitTests_Uninit();
+        __UnitTests_Sites();
+        __UnitTests_HeapProfile();
+        __UnitTests_Stats();
+        __UnitTests_Pool();
+        __UnitTests_Backend();
+        #if defined(MEMORYM_THREAD_LOCAL)
+            __UnitTests_ThreadLocal();
+        #endif
+        #if defined(MEMORYM_SHARED)
+            __UnitTests_Shared();
+        #endif
         return true;
     }
 
 #endif
 
+//////////////////////////////////////////////////////////////////
+/// __memoryMInitialize
+/// 
+/// Set the methods of __localMemoryM and initialize it
+void __memoryMInitialize() {
+
+    __localMemoryM.NewBool          = __newBool;
+    __localMemoryM.NewInt           = __newInt;
+    __localMemoryM.NewString        = __newString;
+    __localMemoryM.ReNewString      = __reNewString;
+    __localMemoryM.FreeAll          = __freeAll;
+    __localMemoryM.GetCount         = __getCount;
+    __localMemoryM.NewStringLen     = __newStringLen;
+    __localMemoryM.NewStringLenUninit = __newStringLenUninit;
+    __localMemoryM.StringConcat     = __concatString;
+    __localMemoryM.InternString     = __internString;
+    __localMemoryM.NewBuilder       = __newBuilder;
+    __localMemoryM.Append           = __append;
+    __localMemoryM.AppendFormat     = __appendFormat;
+    __localMemoryM.ToString         = __toString;
+
+    __localMemoryM.Format           = __format;
+    __localMemoryM.GetReport        = __getReport;
+    __localMemoryM.GetSiteReport    = __getSiteReport;
+    __localMemoryM.WriteReport      = __writeReport;
+    __localMemoryM.WriteHeapProfile = __writeHeapProfile;
+    __localMemoryM.SetSampleRate    = __setSampleRate;
+    __localMemoryM.GetMemoryUsed    = __getMemoryUsed;
+    __localMemoryM.GetLiveCount     = __getLiveCount;
+    __localMemoryM.GetPeakMemoryUsed = __getPeakMemoryUsed;
+    __localMemoryM.GetStats         = __getStats;
+    __localMemoryM.GetContextMemoryUsed = __getContextMemoryUsed;
+    __localMemoryM.Free             = __free;
+    __localMemoryM.PushContext      = __PushContext;
+    __localMemoryM.PopContext       = __PopContext;
+    __localMemoryM.PushArenaContext = __PushArenaContext;
+    __localMemoryM.FreeMultiple     = __freeMultiple;
+    __localMemoryM.NewMany          = __newMany;
+    __localMemoryM.FreeArray        = __freeArray;
+
+    __localMemoryM.NewDate          = __newDate;
+    __localMemoryM.ReNewDate        = __reNewDate;
+    
+    __localMemoryM.NewDateTime      = __newDateTime;
+    __localMemoryM.FormatDateTime   = __formatDateTime;
+    __localMemoryM.ReFormatDateTime = __reFormatDateTime;
+    
+        
+
+    #if !defined(WINFORMEBBLE)
+        __localMemoryM.UnitTests  = __UnitTests;
+    #endif
+
+    __Initialize();
+}
+
+#if defined(MEMORYM_SHARED)
+
+// *** Shared methods *** 
+// The methods reading or changing all the shards, the others lock the shard of 
+// the pointer they receive.
+
+int __sharedGetCount() {
+
+    int count = 0;
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+        MemoryShardLock lock(shard);
+        count += __getCount() + 1;
+    }
+    return count - 1;
+}
+int __sharedGetMemoryUsed() {
+
+    int used = 0;
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+        MemoryShardLock lock(shard);
+        used += __localMemoryM._memoryUsed;
+    }
+    return used;
+}
+int __sharedGetLiveCount() {
+
+    int live = 0;
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+        MemoryShardLock lock(shard);
+        live += __localMemoryM._liveCount;
+    }
+    return live;
+}
+int __sharedGetPeakMemoryUsed() {
+
+    return __sharedPeakMemoryUsed;
+}
+//////////////////////////////////////////////////////////////////
+/// __sharedGetStats
+/// 
+/// Sum the stats of the shards like the other counters, the peaks come from 
+/// the process wide atomics, there is no timeline
+void __sharedGetStats(MemoryStats* stats) {
+
+    memset(stats, 0, sizeof(MemoryStats));
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+        MemoryShardLock lock(shard);
+        MemoryStats shardStats;
+        __getStats(&shardStats);
+        stats->memoryUsed     += shardStats.memoryUsed;
+        stats->liveCount      += shardStats.liveCount;
+        stats->contextLevel    = shardStats.contextLevel; // The shards have the same stack
+        for (int level = 0; level < MEMORYM_STATS_CONTEXT_COUNT; level++) {
+            stats->contextMemoryUsed[level] += shardStats.contextMemoryUsed[level];
+        }
+    }
+    stats->peakMemoryUsed = __sharedPeakMemoryUsed;
+    stats->peakLiveCount  = __sharedPeakLiveCount;
+    for (int level = 0; level <= stats->contextLevel && level < MEMORYM_STATS_CONTEXT_COUNT; level++) {
+        stats->contextPeakMemoryUsed[level] = __sharedContextPeak[level];
+    }
+    __poolGetStats(stats);
+}
+int __sharedGetContextMemoryUsed(int level) {
+
+    int used = 0;
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+        MemoryShardLock lock(shard);
+        int shardUsed = __getContextMemoryUsed(level);
+        if (shardUsed == -1)
+            return -1;
+        used += shardUsed;
+    }
+    return used;
+}
+//////////////////////////////////////////////////////////////////
+/// __sharedForEachShard
+/// 
+/// Lock all the shards in order then call method on each shard, so 
+/// the shards keep the same context stack
+bool __sharedForEachShard(bool(*method)()) {
+
+    bool result = true;
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+        __sharedLocks[shard].lock();
+    }
+    MemoryManager* previous = __shard;
+    __sharedAllLocked       = true;
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+        __shard = &__sharedShards[shard];
+        result  = method() && result;
+    }
+    __sharedAllLocked       = false;
+    __shard = previous;
+    for (int shard = MEMORYM_SHARD_COUNT - 1; shard >= 0; shard--) {
+        __sharedLocks[shard].unlock();
+    }
+    return result;
+}
+//////////////////////////////////////////////////////////////////
+/// __sharedPushContextShard
+/// 
+/// Push the context of a shard, the process wide counters of the new context 
+/// start from 0 like the ones of the shards, while all the shards are locked
+bool __sharedPushContextShard() {
+
+    if (!__PushContext())
+        return false;
+
+    int level = __localMemoryM._contextStackIndex;
+    if (__shard == &__sharedShards[0] && level < MEMORYM_STATS_CONTEXT_COUNT) {
+        __sharedContextUsed[level] = 0;
+        __sharedContextPeak[level] = 0;
+    }
+    return true;
+}
+bool __sharedPushContext() {
+
+    return __sharedForEachShard(__sharedPushContextShard);
+}
+bool __sharedPopContext() {
+
+    return __sharedForEachShard(__PopContext);
+}
+bool __sharedFreeAllShard() {
+
+    __freeAll();
+    int shard = (int)(__shard - __sharedShards);
+    phash_free(__sharedMoved[shard]);
+    __sharedMoved[shard] = NULL;
+    return true;
+}
+void __sharedFreeAll() {
+
+    __sharedForEachShard(__sharedFreeAllShard);
+}
+
+std::once_flag __sharedInitialized;
+
+void __sharedInitialize() {
+
+    for (int shard = 0; shard < MEMORYM_SHARD_COUNT; shard++) {
+        MemoryShardLock lock(shard);
+        __memoryMInitialize();
+        __sharedMoved[shard] = phash_init();
+    }
+    MemoryManager sharedMemoryM = __sharedShards[0]; // Same methods, with the ones combining the shards
+    sharedMemoryM.GetCount             = __sharedGetCount;
+    sharedMemoryM.GetMemoryUsed        = __sharedGetMemoryUsed;
+    sharedMemoryM.GetLiveCount         = __sharedGetLiveCount;
+    sharedMemoryM.GetPeakMemoryUsed    = __sharedGetPeakMemoryUsed;
+    sharedMemoryM.GetContextMemoryUsed = __sharedGetContextMemoryUsed;
+    sharedMemoryM.GetStats             = __sharedGetStats;
+    sharedMemoryM.PushContext          = __sharedPushContext;
+    sharedMemoryM.PopContext           = __sharedPopContext;
+    sharedMemoryM.PushArenaContext     = __sharedPushContext; // No arena, a regular context
+    sharedMemoryM.FreeAll              = __sharedFreeAll;
+    __sharedMemoryM = sharedMemoryM;
+}
 MemoryManager * memoryM() {
 
-    if (__localMemoryM.NewBool == NULL) {
+    // The threads calling memoryM() first wait for one of them to initialize the instance
+    std::call_once(__sharedInitialized, __sharedInitialize);
+    return &__sharedMemoryM;
+}
 
-        __localMemoryM.NewBool          = __newBool;
-        __localMemoryM.NewInt           = __newInt;
-        __localMemoryM.NewString        = __newString;
-        __localMemoryM.ReNewString      = __reNewString;
-        __localMemoryM.FreeAll          = __freeAll;
-        __localMemoryM.GetCount         = __getCount;
-        __localMemoryM.NewStringLen     = __newStringLen;
-        __localMemoryM.StringConcat     = __concatString;
-
-        __localMemoryM.Format           = __format;
-        __localMemoryM.GetReport        = __getReport;
-        __localMemoryM.GetMemoryUsed    = __getMemoryUsed;
-        __localMemoryM.Free             = __free;
-        __localMemoryM.PushContext      = __PushContext;
-        __localMemoryM.PopContext       = __PopContext;
-        __localMemoryM.FreeMultiple     = __freeMultiple;
-
-        __localMemoryM.NewDate          = __newDate;
-        __localMemoryM.ReNewDate        = __reNewDate;
-        
-        __localMemoryM.NewDateTime      = __newDateTime;
-        __localMemoryM.FormatDateTime   = __formatDateTime;
-        __localMemoryM.ReFormatDateTime = __reFormatDateTime;
-        
-            
+#else
 
-        #if !defined(WINFORMEBBLE)
-            __localMemoryM.UnitTests  = __UnitTests;
-        #endif
+MemoryManager * memoryM() {
 
-        __Initialize();
+    if (__localMemoryM.NewBool == NULL) {
+        __memoryMInitialize();
     }
     return &__localMemoryM;
 }
 
+#endif
+
+bool __memoryMInitialized() {
+
+    #if defined(MEMORYM_SHARED)
+        return __sharedMemoryM.NewBool != NULL;
+    #else
+        return __localMemoryM.NewBool != NULL;
+    #endif
+}
+//////////////////////////////////////////////////////////////////
+/// memoryM_InitWithBackend
+/// 
+/// Take the memory of MemoryM from backend, then initialize the instance. 
+/// With MEMORYM_THREAD_LOCAL the instances of the other threads also use 
+/// the backend, the function must be called before any thread calls memoryM()
+bool memoryM_InitWithBackend(MemoryBackend* backend) {
+
+    if (__memoryMInitialized() || backend == NULL || backend->Alloc == NULL || backend->Realloc == NULL || backend->Free == NULL)
+        return false;
+
+    __backend        = *backend;
+    __backendReserve = backend->mayFail;
+    phash_set_allocator(__sysMalloc, __sysFree);
+    memoryM();
+    return true;
+}
+bool memoryM_InitWithPool(void* buffer, size_t size) {
+
+    if (__memoryMInitialized()) // Before the pool is written in buffer
+        return false;
+
+    MemoryBackend backend = MemoryBackend_Pool(buffer, size);
+    return memoryM_InitWithBackend(&backend);
+}
+
 /*
 
 http://api.thingspeak.com/update?key=N7RV4GSNJWDTTNT6&field1=1111&field2=2222
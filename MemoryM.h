@@ -20,13 +20,79 @@ WinFormebble (https://github.com/fredericaltorres/WinFormebble)
     #include <time.h> 
     #include <string.h>
     #include "darray.h"
+    #include "phash.h"
 
 #endif
 
 #define MEMORYM_MAX_REPORT_SIZE 1024
 #define MEMORYM_TRUE "true"
 #define MEMORYM_FALSE "false"
-#define MEMORYM_STACK_CONTEXT_SIZE 4
+#define MEMORYM_STACK_CONTEXT_SIZE 4 // Initial capacity of the context stack, it grows with the nesting
+#define MEMORYM_ARENA_CHUNK_SIZE 4096
+#define MEMORYM_ARENA_MAX_CHUNK_SIZE 65536
+#define MEMORYM_SLAB_CLASS_COUNT 7
+#define MEMORYM_REPORT_TEXT 0
+#define MEMORYM_REPORT_CSV 1
+#define MEMORYM_REPORT_JSON 2
+#define MEMORYM_REPORT_LIVE_ONLY 0x100 // Combined with a format, skip the available entries
+// Number of dates formatted by FormatDateTime() cached per thread
+#if !defined(MEMORYM_DATE_CACHE_SIZE)
+    #define MEMORYM_DATE_CACHE_SIZE 4
+#endif
+#define MEMORYM_DATE_CACHE_TEXT 64 // Longer formats and texts are not cached
+// Strings shorter than MEMORYM_INLINE_STRING_SIZE byte with the \0 re allocated by a rewrite
+// get a slot of this capacity, so the next rewrites are in place, 0 to disable
+#if !defined(MEMORYM_INLINE_STRING_SIZE)
+    #define MEMORYM_INLINE_STRING_SIZE 24
+#endif
+// Define MEMORYM_SITE_STATS to count the allocations of each call site of the MM_...() macros
+#if !defined(MEMORYM_SITE_COUNT)
+    #define MEMORYM_SITE_COUNT 1024 // Capacity of the call site table, a power of 2
+#endif
+#define MEMORYM_SITE_HISTOGRAM 12 // Buckets of the size histogram of a site, 1-8, 9-16, ... byte
+// Define MEMORYM_HEAP_PROFILE to record the stack of about one allocation every 
+// MEMORYM_SAMPLE_RATE byte allocated, the live samples are written by WriteHeapProfile()
+#if !defined(MEMORYM_SAMPLE_RATE)
+    #define MEMORYM_SAMPLE_RATE (512 * 1024) // Mean byte allocated between 2 samples
+#endif
+#define MEMORYM_SAMPLE_DEPTH 32 // Frames recorded by sample
+#define MEMORYM_PROFILE_PPROF 0  // Heap profile read by pprof
+#define MEMORYM_PROFILE_FOLDED 1 // Folded stacks read by flamegraph.pl
+// Define MEMORYM_TIMELINE_SIZE to keep the last (time, live byte) samples taken every 
+// MEMORYM_TIMELINE_PERIOD allocations and frees, returned by GetStats()
+#if !defined(MEMORYM_TIMELINE_SIZE) || defined(MEMORYM_SHARED) // No timeline of the shards
+    #undef MEMORYM_TIMELINE_SIZE
+    #define MEMORYM_TIMELINE_SIZE 0
+#endif
+#if !defined(MEMORYM_TIMELINE_PERIOD)
+    #define MEMORYM_TIMELINE_PERIOD 16
+#endif
+#define MEMORYM_STATS_CONTEXT_COUNT 8 // Context levels reported by GetStats()
+#define MEMORYM_POOL_MIN_SIZE (32 * 1024) // Smallest buffer accepted by memoryM_InitWithPool()
+#define MEMORYM_BACKEND_ALIGN (2 * sizeof(void*)) // Alignment of malloc(), requested for all the blocks but the slab pages
+// Define MEMORYM_NO_SLAB to allocate the small allocations with malloc()
+#if !defined(MEMORYM_SLAB_PAGE_SIZE)
+    #define MEMORYM_SLAB_PAGE_SIZE 4096
+#endif
+// Define MEMORYM_THREAD_LOCAL to give each thread its own memory manager
+#if defined(MEMORYM_THREAD_LOCAL)
+    #define MEMORYM_TLS thread_local
+#else
+    #define MEMORYM_TLS
+#endif
+// Define MEMORYM_SHARED to share the memory manager between threads, the registry
+// is split in MEMORYM_SHARD_COUNT shards selected by the hash of the pointer
+#if defined(MEMORYM_SHARED)
+    #if defined(MEMORYM_THREAD_LOCAL)
+        #error MEMORYM_SHARED and MEMORYM_THREAD_LOCAL cannot be used together
+    #endif
+    #if !defined(MEMORYM_SHARD_COUNT)
+        #define MEMORYM_SHARD_COUNT 16 // Must be a power of 2
+    #endif
+    #if !defined(MEMORYM_NO_SLAB)
+        #define MEMORYM_NO_SLAB // The slabs are not shared, malloc() is thread safe
+    #endif
+#endif
 
     /* ============== MemoryM  ==================
 
@@ -40,25 +106,244 @@ WinFormebble (https://github.com/fredericaltorres/WinFormebble)
         void * data;
     } MemoryAllocation;
 
-    DArray*             MemoryAllocation_New       ();
-    void                MemoryAllocation_PushA     (DArray *array, MemoryAllocation *s);
-    void                MemoryAllocation_Push      (DArray *array, int size, void *data);
-    MemoryAllocation*   MemoryAllocation_Pop       (DArray *array);
-    MemoryAllocation*   MemoryAllocation_Get       (DArray *array, int index);
-    void                MemoryAllocation_Set       (DArray *array, int index, MemoryAllocation *s);
-    void                MemoryAllocation_Destructor(DArray *array);
-    int                 MemoryAllocation_GetLength (DArray *array);
+    // The allocations are stored as a structure of arrays, the entry at index is 
+    // (data[index], size[index]) and MemoryAllocation is only a view of an entry.
+    // allocated[index] is the number of byte really allocated for data[index], 
+    // greater than size[index] when the allocation has spare capacity. 
+    // generation[index] is the generation of the context owning the entry, the
+    // entries of a context are linked by next[index] and previous[index].
+    // references[index] is the number of InternString() sharing the entry, 0 when 
+    // the entry is not an interned string.
+    typedef struct {
+
+        void** data;
+        int*   size;
+        int*   allocated;
+        unsigned long long* generation;
+        int*   next;
+        int*   previous;
+        int*   references;
+        #if defined(MEMORYM_SITE_STATS)
+            int* site; // Call site of the allocation, -1 when not allocated through a MM_...() macro
+        #endif
+        #if defined(MEMORYM_HEAP_PROFILE)
+            int* sample; // Sample of the allocation, -1 when not sampled
+        #endif
+        int    last;     // Index of the last entry, -1 when empty
+        int    capacity;
+    } MemoryAllocationArray;
+
+    MemoryAllocationArray* MemoryAllocation_New    ();
+    bool                MemoryAllocation_PushA     (MemoryAllocationArray *array, MemoryAllocation *s);
+    bool                MemoryAllocation_Push      (MemoryAllocationArray *array, int size, void *data);
+    bool                MemoryAllocation_PushAllocated(MemoryAllocationArray *array, int size, int allocated, void *data);
+    MemoryAllocation    MemoryAllocation_Pop       (MemoryAllocationArray *array);
+    MemoryAllocation    MemoryAllocation_Get       (MemoryAllocationArray *array, int index);
+    bool                MemoryAllocation_Set       (MemoryAllocationArray *array, int index, MemoryAllocation *s);
+    void                MemoryAllocation_Destructor(MemoryAllocationArray *array);
+    int                 MemoryAllocation_GetLength (MemoryAllocationArray *array);
+
+    void MemoryAllocation_FreeAllocation(MemoryAllocationArray *array, int index);
+
+    // Bitmap of the available entries of the registry, a bit set means the entry
+    // at this index has no data and can be re used. The summary has one bit per
+    // word of bits, set when the word is not 0, so the first available entry is 
+    // found with 2 find first set instead of a scan of the registry.
+    typedef struct {
+
+        unsigned long long* bits;
+        unsigned long long* summary;
+        int words;        // Number of words in bits
+        int firstSummary; // All the summary words before this one are 0
+    } FreeSlotBitmap;
+
+    void FreeSlotBitmap_Init    (FreeSlotBitmap *b);
+    void FreeSlotBitmap_Set     (FreeSlotBitmap *b, int index);
+    void FreeSlotBitmap_Clear   (FreeSlotBitmap *b, int index);
+    int  FreeSlotBitmap_First   (FreeSlotBitmap *b);
+    void FreeSlotBitmap_Destructor(FreeSlotBitmap *b);
+
+    // Arena of a context pushed with PushArenaContext(), a list of chunks 
+    // where the allocations are bump allocated
+    typedef struct MemoryArenaChunk {
+
+        struct MemoryArenaChunk* previous;
+        int size; // Number of byte available after the chunk header
+        int used;
+    } MemoryArenaChunk;
+
+    typedef struct {
+
+        bool enabled;
+        MemoryArenaChunk* chunk; // Current chunk
+        int liveCount;
+        int memoryUsed;
+    } MemoryArena;
+
+    // Context pushed on the stack. The generation is unique for the life of the memory 
+    // manager and increases with each push, first is the first entry of the registry
+    // owned by the context, -1 when none.
+    typedef struct {
+
+        unsigned long long generation;
+        int                first;
+        int                memoryUsed;
+        int                peakMemoryUsed; // Highest memoryUsed since the push
+        MemoryArena        arena;
+    } MemoryContext;
+
+    // Sample of the timeline, time is in nanoseconds of a monotonic clock
+    typedef struct {
+
+        long long time;
+        int       memoryUsed;
+        int       liveCount;
+    } MemoryTimelineSample;
+
+    // Ring buffer of the last MEMORYM_TIMELINE_SIZE samples, next is the slot of the 
+    // next sample and events the number of allocations and frees until the next sample
+    typedef struct {
+
+        MemoryTimelineSample samples[MEMORYM_TIMELINE_SIZE > 0 ? MEMORYM_TIMELINE_SIZE : 1];
+        int count;
+        int next;
+        int events;
+    } MemoryTimeline;
+
+    // Counters returned by GetStats(), the context at level is reported when level is 
+    // lower or equal to contextLevel and to MEMORYM_STATS_CONTEXT_COUNT - 1.
+    // The pool counters are 0 without memoryM_InitWithPool()
+    typedef struct {
+
+        int memoryUsed;
+        int liveCount;
+        int peakMemoryUsed;
+        int peakLiveCount;
+        int contextLevel; // Level of the current context, -1 when none
+        int contextMemoryUsed[MEMORYM_STATS_CONTEXT_COUNT];
+        int contextPeakMemoryUsed[MEMORYM_STATS_CONTEXT_COUNT]; // Highest byte of the context since its push
+        int timelineCount;
+        MemoryTimelineSample timeline[MEMORYM_TIMELINE_SIZE > 0 ? MEMORYM_TIMELINE_SIZE : 1]; // The oldest first
+        size_t poolSize;        // Byte of the pool usable by the allocations
+        size_t poolFree;        // Byte of the free blocks
+        size_t poolLargestFree; // Largest allocation possible
+        int    poolFailures;    // Allocations refused because the pool was exhausted
+        double poolFragmentation; // 1 - poolLargestFree / poolFree, 0 when the free memory is one block
+    } MemoryStats;
+
+    // Hash table of the interned strings, open addressing by hash and length with 
+    // linear probing. index is the entry of the string in the registry, -1 when 
+    // the slot is empty
+    typedef struct {
+
+        unsigned int hash;
+        int          length;
+        int          index;
+    } MemoryInternEntry;
+
+    typedef struct {
+
+        MemoryInternEntry* entries;
+        int                count;
+        int                size; // 0 until the first InternString(), then a power of 2
+    } MemoryInternTable;
+
+    // Slab allocator, a page of slots of the same size class
+    typedef struct MemorySlabPage {
+
+        struct MemorySlabPage* previous;
+        char* slots;      // Aligned on a cache line by the backend
+        int   used;       // Number of byte used by the slots already handed out
+    } MemorySlabPage;
+
+    typedef struct {
+
+        MemorySlabPage* page; // Current page
+        void** freeSlots;     // Stack of the slots freed
+        int    freeCount;
+        int    freeCapacity;
+    } MemorySlabClass;
+
+    // With MEMORYM_THREAD_LOCAL each allocation is preceded by the manager of the
+    // thread owning it. A block freed by another thread is pushed in the lock free
+    // queue _remoteFree of its owner, found in the registry of the managers, next links 
+    // the blocks of the queue. Until then next is a tag of the owner, so a block is queued once.
+    typedef struct MemoryOwnerHeader {
+
+        struct MemoryOwnerHeader* next;
+        void*                     owner;
+    } MemoryOwnerHeader;
+
+    #if defined(MEMORYM_THREAD_LOCAL)
+        #define MEMORYM_OWNER_HEADER
+        #define MEMORYM_OWNER_SIZE ((int)sizeof(MemoryOwnerHeader))
+    #else
+        #define MEMORYM_OWNER_SIZE 0
+    #endif
 
-    void MemoryAllocation_FreeAllocation(MemoryAllocation *a);
+    // Destination of WriteReport(), the report is streamed through a buffer of
+    // MEMORYM_MAX_REPORT_SIZE char on the stack, nothing is allocated
+    typedef void(*MemoryReportWrite)(void* userData, char* data, int len);
 
     typedef struct {
 
-        // _memoryAllocation is a Darray (DynamicArray), though we never remove
+        FILE*             file;     // fwrite() to file when not NULL
+        int               fd;       // Else write() to fd when not -1
+        MemoryReportWrite write;    // Else call write(userData, data, len)
+        void*             userData;
+    } MemoryReportSink;
+
+    // Counters of a call site with MEMORYM_SITE_STATS, shared by all the threads
+    typedef struct {
+
+        const char* file; // NULL when the slot of the table is empty
+        const char* function;
+        int         line;
+        long long   count;     // Number of allocations
+        long long   bytes;     // Byte allocated
+        long long   liveBytes; // Byte still allocated
+        long long   frees;
+        long long   histogram[MEMORYM_SITE_HISTOGRAM]; // Number of allocations by size
+    } MemorySite;
+
+    MemoryReportSink MemoryReportSink_File    (FILE* file);
+    MemoryReportSink MemoryReportSink_Fd      (int fd);
+    MemoryReportSink MemoryReportSink_Callback(MemoryReportWrite write, void* userData);
+
+    typedef struct {
+
+        // _memoryAllocation is a dynamic array, though we never remove
         // a created entry, but we re use entry available.
-        DArray*	_memoryAllocation;
+        MemoryAllocationArray* _memoryAllocation;
+        // Hash index from the data pointer to the index of the MemoryAllocation in 
+        // _memoryAllocation, so Free() and the Re...() methods do not scan the array
+        PHash*  _memoryIndex;
+        // Available entries of _memoryAllocation
+        FreeSlotBitmap _freeSlots;
+        // Interned strings of this manager
+        MemoryInternTable _internTable;
+
+        MemoryContext*     _contextStack;
+        int                _contextStackIndex;
+        int                _contextStackCapacity;
+        unsigned long long _contextGeneration; // Generation of the last context pushed
 
-        int _contextStack[MEMORYM_STACK_CONTEXT_SIZE];
-        int _contextStackIndex;
+        // Running counters updated on every allocation and free
+        int _memoryUsed;
+        int _liveCount;
+        int _peakMemoryUsed;
+        int _peakLiveCount;
+        #if MEMORYM_TIMELINE_SIZE > 0
+            MemoryTimeline _timeline;
+        #endif
+
+        MemorySlabClass _slabClasses[MEMORYM_SLAB_CLASS_COUNT];
+
+        // Blocks freed by other threads, drained by the owner thread
+        MemoryOwnerHeader* volatile _remoteFree;
+        // With MEMORYM_THREAD_LOCAL, lock of _memoryIndex and next manager of the registry of the threads
+        volatile int _indexLock;
+        void*        _nextManager;
 
         // Allocate a new boolean
         bool*(*NewBool)();
@@ -66,12 +351,28 @@ WinFormebble (https://github.com/fredericaltorres/WinFormebble)
         int *(*NewInt)();
         // Allocate a new string for len size (do not add the extra char for the \0)
         char*(*NewStringLen)(int size);
+        // Allocate a new string for len size without setting its content to 0, only the \0 at size is set
+        char*(*NewStringLenUninit)(int size);
+        // Allocate n allocations of sizes[i] byte in out[i], the registry grows once for the batch. Return out
+        void**(*NewMany)(int* sizes, int n, void** out);
         // Allocate a new string identical to the string passed
-        char*(*NewString)(char* s);
+        char*(*NewString)(const char* s);
         // Re allocate a new string identical to the string passed, but re use the internal MemoryAllocation object
-        char*(*ReNewString)(char* s, char* previousAllocation);
+        char*(*ReNewString)(const char* s, char* previousAllocation);
         // Concat the string s to the string previousAllocation already managed by MemoryM 
-        char*(*StringConcat)(char* s, char* previousAllocation);
+        char*(*StringConcat)(const char* s, char* previousAllocation);
+        // Return the shared copy of s, allocated on the first call. Each call must be matched by a Free().
+        // The copy belongs to no context, the Re...() methods return a new string and release one reference
+        char*(*InternString)(const char* s);
+
+        // Allocate a new empty string builder with the capacity to store capacityHint char without re allocation
+        char*(*NewBuilder)(int capacityHint);
+        // Append len char of s to the string builder sb, if len is -1 append all s. The capacity grows geometrically
+        char*(*Append)(char* sb, const char* s, int len);
+        // Append to the string builder sb using Format()
+        char*(*AppendFormat)(char* sb, const char* format, ...);
+        // Return the string built by sb without copy, sb must not be used as a builder anymore
+        char*(*ToString)(char* sb);
 
         // Return a re usable empty string
         char*(*EmptyString)();
@@ -84,21 +385,42 @@ WinFormebble (https://github.com/fredericaltorres/WinFormebble)
         struct tm *(*NewDateTime)(int year, int month, int day, int hour, int minutes, int seconds);
 
         // Format using sprintf, but return a string allocated by MemoryM
-        char*(*Format)(char* s, ...);
+        char*(*Format)(const char* s, ...);
         // Format the Date using strftime(), but return a string allocated by MemoryM
-        char*(*FormatDateTime)(struct tm *date, char* format);
-        // Re allocate and re format the Date using strftime(), but re use the internal MemoryAllocation object
-        char*(*ReFormatDateTime)(struct tm *date, char* format, char * previousAllocation);
+        char*(*FormatDateTime)(struct tm *date, const char* format);
+        // Re format the Date using strftime() in previousAllocation, in place when the text fits in its capacity
+        char*(*ReFormatDateTime)(struct tm *date, const char* format, char * previousAllocation);
 
         // Free a specific allocation
         bool(*Free)(void* data);
         // Free multiple specific allocation
         int(*FreeMultiple)(int n, ...);
+        // Free the n allocations of data in one pass, return the number of pointers not managed
+        int(*FreeArray)(void** data, int n);
 
         // Return a string allocated by MemoryM, presenting the current memory allocation
         char*(*GetReport)();
+        // Return a string allocated by MemoryM, presenting the count call sites allocating the most 
+        // byte with MEMORYM_SITE_STATS
+        char*(*GetSiteReport)(int count);
+        // Stream the report of the current memory allocation to sink without allocation, options is 
+        // MEMORYM_REPORT_TEXT, MEMORYM_REPORT_CSV or MEMORYM_REPORT_JSON combined with MEMORYM_REPORT_LIVE_ONLY
+        bool (*WriteReport)(MemoryReportSink* sink, int options);
+        // Stream the stacks of the sampled live allocations with MEMORYM_HEAP_PROFILE, format is 
+        // MEMORYM_PROFILE_PPROF or MEMORYM_PROFILE_FOLDED. Return false without MEMORYM_HEAP_PROFILE
+        bool (*WriteHeapProfile)(MemoryReportSink* sink, int format);
+        // Set the mean byte allocated between 2 samples, 1 samples every allocation. Return the previous rate
+        int  (*SetSampleRate)(int bytes);
         // Return how many total byte are allocated
         int  (*GetMemoryUsed)();
+        // Return the number of live allocation
+        int  (*GetLiveCount)();
+        // Return the highest number of byte allocated at the same time
+        int  (*GetPeakMemoryUsed)();
+        // Return how many byte are allocated by the context at level, -1 if the level is not pushed
+        int  (*GetContextMemoryUsed)(int level);
+        // Copy the counters, the peaks and the timeline in stats, without scanning the allocations
+        void (*GetStats)(MemoryStats* stats);
         // Free all
         void (*FreeAll)();
         // Return the total number of allocation created
@@ -108,12 +430,73 @@ WinFormebble (https://github.com/fredericaltorres/WinFormebble)
         bool(*PushContext)();
         // Restore the state of the memory manager to the previous Push
         bool(*PopContext)();
+        // Mark the state of the memory manager, the allocations until the next Pop
+        // are allocated in an arena released at once by the Pop
+        bool(*PushArenaContext)();
 
         bool(*UnitTests)();
 
     } MemoryManager;
 
-    // Function that return the sigleton instance
+    // Allocator of all the memory of MemoryM, set by memoryM_InitWithBackend(). Free() and Realloc() 
+    // receive the size of the block given to Alloc() or Realloc(), and Free() its alignment. data is 
+    // never NULL. AllocZero() returns size byte set to 0, it can be NULL to use Alloc() and memset().
+    // When mayFail is true, as for a pool, the slab allocator is not used so a freed block goes back 
+    // to the backend at once, and the registry grows before an allocation so a failure changes nothing
+    typedef struct {
+
+        void* (*Alloc)(void* context, size_t size, size_t align); // align is a power of 2
+        void* (*AllocZero)(void* context, size_t size);
+        void* (*Realloc)(void* context, void* data, size_t size, size_t newSize);
+        void  (*Free)(void* context, void* data, size_t size, size_t align);
+        void* context;
+        bool  mayFail; // The memory of the backend is bounded
+    } MemoryBackend;
+
+    // malloc() and free(), the default
+    MemoryBackend MemoryBackend_Libc();
+    // malloc() with the sized deallocation of jemalloc sdallocx() or C23 free_sized() when they are 
+    // linked, else free()
+    MemoryBackend MemoryBackend_Sized();
+    // The two level segregated fit pool in the size byte of buffer, the Alloc of the backend is NULL 
+    // if size is lower than MEMORYM_POOL_MIN_SIZE
+    MemoryBackend MemoryBackend_Pool(void* buffer, size_t size);
+
+    // Function that return the sigleton instance, the instance of the current
+    // thread with MEMORYM_THREAD_LOCAL
     MemoryManager* memoryM(); 
+    // Initialize MemoryM to take all its memory, the allocations and the registry, from the 
+    // size byte of buffer instead of malloc(). Must be called before the first memoryM(). 
+    // When the buffer is exhausted the allocation methods return NULL. Return false if 
+    // MemoryM is already initialized or size is lower than MEMORYM_POOL_MIN_SIZE
+    bool memoryM_InitWithPool(void* buffer, size_t size);
+    // Initialize MemoryM to take all its memory from backend, copied. Must be called before the 
+    // first memoryM(). When the backend fails the allocation methods return NULL. Return false if 
+    // MemoryM is already initialized or a method of the backend is missing
+    bool memoryM_InitWithBackend(MemoryBackend* backend);
+
+    // MM_SITE(call) makes the allocations of call count for the call site, with 
+    // MEMORYM_SITE_STATS. Else the macros are only the call.
+    #if defined(MEMORYM_SITE_STATS)
+        void MemorySite_Enter(const char* file, int line, const char* function);
+        void MemorySite_Leave();
+        template<typename T> inline T MemorySite_Leave(T value) {
+            MemorySite_Leave();
+            return value;
+        }
+        #define MM_SITE(call) (MemorySite_Enter(__FILE__, __LINE__, __func__), MemorySite_Leave(call))
+    #else
+        #define MM_SITE(call) (call)
+    #endif
+    #define MM_NEW_BOOL()                       MM_SITE(memoryM()->NewBool())
+    #define MM_NEW_INT()                        MM_SITE(memoryM()->NewInt())
+    #define MM_NEW_STRING(s)                    MM_SITE(memoryM()->NewString(s))
+    #define MM_NEW_STRING_LEN(size)             MM_SITE(memoryM()->NewStringLen(size))
+    #define MM_RENEW_STRING(s, previous)        MM_SITE(memoryM()->ReNewString((s), (previous)))
+    #define MM_STRING_CONCAT(s, previous)       MM_SITE(memoryM()->StringConcat((s), (previous)))
+    #define MM_INTERN_STRING(s)                 MM_SITE(memoryM()->InternString(s))
+    #define MM_FORMAT(...)                      MM_SITE(memoryM()->Format(__VA_ARGS__))
+    #define MM_NEW_DATE()                       MM_SITE(memoryM()->NewDate())
+    #define MM_FORMAT_DATE_TIME(date, format)   MM_SITE(memoryM()->FormatDateTime((date), (format)))
 
     #endif
\ No newline at end of file
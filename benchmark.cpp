@@ -0,0 +1,1258 @@
+/*
+    MemoryM
+    Benchmarks
+
+    MIT License
+
+    Standalone console application, not part of the Visual Studio project.
+    Build and run on Linux:
+
+        g++ -O2 -pthread -o memorym_benchmark benchmark.cpp MemoryM.cpp darray.cpp phash.cpp
+        ./memorym_benchmark [benchmark name]
+        ./memorym_benchmark Suite [file.json]
+
+    Add -DMEMORYM_THREAD_LOCAL to measure the Threads benchmark with a memory
+    manager per thread, or -DMEMORYM_SHARED with a sharded shared memory manager,
+    else the threads share the memory manager behind a global mutex.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "darray.h"
+#include "MemoryM.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    #include <malloc.h>
+    #define BENCH_HEAP_USED() ((double)mallinfo2().uordblks)
+#else
+    #define BENCH_HEAP_USED() (0.0)
+#endif
+#if defined(__GLIBC__)
+    // Count the calls to malloc(), calloc() and realloc() of the Suite benchmark, 
+    // from one thread, by replacing them in the executable
+    extern "C" void* __libc_malloc(size_t size);
+    extern "C" void* __libc_calloc(size_t count, size_t size);
+    extern "C" void* __libc_realloc(void* p, size_t size);
+    bool      __benchCountMallocs;
+    long long __benchMallocs;
+    extern "C" void* malloc(size_t size) {
+        if (__benchCountMallocs)
+            __benchMallocs++;
+        return __libc_malloc(size);
+    }
+    extern "C" void* calloc(size_t count, size_t size) {
+        if (__benchCountMallocs)
+            __benchMallocs++;
+        return __libc_calloc(count, size);
+    }
+    extern "C" void* realloc(void* p, size_t size) {
+        if (__benchCountMallocs)
+            __benchMallocs++;
+        return __libc_realloc(p, size);
+    }
+    #define BENCH_MALLOCS() ((double)__benchMallocs)
+#else
+    bool __benchCountMallocs;
+    #define BENCH_MALLOCS() (-1.0)
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    #include <unistd.h>
+    #include <sys/resource.h>
+    // Byte of memory touched for the first time, from the minor page faults
+    double __benchTouched() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return (double)usage.ru_minflt * sysconf(_SC_PAGESIZE);
+    }
+    #define BENCH_TOUCHED() __benchTouched()
+#else
+    #define BENCH_TOUCHED() (0.0)
+#endif
+
+//////////////////////////////////////////////////////////////////
+/// __benchNow
+///
+/// Return a monotonic time in nano seconds
+double __benchNow() {
+
+    #ifdef _WIN32
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+    #endif
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchFreeLatency
+///
+/// Average latency of Free() while n allocations are alive.
+/// The allocations are freed in a scattered order, so a lookup cannot
+/// benefit from the position of the entry in the registry.
+void __benchFreeLatency() {
+
+    int liveCounts[] = { 1000, 10000, 100000 };
+
+    printf("FreeLatency\r\n");
+    printf("%10s %12s\r\n", "live", "ns/Free");
+
+    for (int c = 0; c < (int)(sizeof(liveCounts) / sizeof(liveCounts[0])); c++) {
+
+        int n       = liveCounts[c];
+        int** ints  = (int**)malloc(n * sizeof(int*));
+
+        memoryM()->PushContext();
+        for (int i = 0; i < n; i++) {
+            ints[i] = memoryM()->NewInt();
+        }
+
+        double start = __benchNow();
+        for (int i = 0; i < n; i++) {
+            memoryM()->Free(ints[(i * 7919) % n]); // 7919 is prime, visit every entry once
+        }
+        double elapsed = __benchNow() - start;
+        memoryM()->PopContext();
+
+        printf("%10d %12.1f\r\n", n, elapsed / n);
+        free(ints);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchNewLatency
+///
+/// Average latency of NewInt() when n allocations are alive and the
+/// registry has no available entry, the worst case to find a free entry.
+void __benchNewLatency() {
+
+    int liveCounts[] = { 1000, 10000, 100000 };
+    int newCount     = 10000;
+
+    printf("NewLatency\r\n");
+    printf("%10s %12s\r\n", "live", "ns/NewInt");
+
+    for (int c = 0; c < (int)(sizeof(liveCounts) / sizeof(liveCounts[0])); c++) {
+
+        int n = liveCounts[c];
+
+        memoryM()->PushContext();
+        for (int i = 0; i < n; i++) {
+            memoryM()->NewInt();
+        }
+
+        double start = __benchNow();
+        for (int i = 0; i < newCount; i++) {
+            memoryM()->NewInt();
+        }
+        double elapsed = __benchNow() - start;
+        memoryM()->PopContext();
+
+        printf("%10d %12.1f\r\n", n, elapsed / newCount);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchContextStrings
+///
+/// Request scoped work: allocate n small strings between a Push and a Pop,
+/// with a registry context and with an arena context
+void __benchContextStrings() {
+
+    int n       = 10000;
+    int rounds  = 20;
+
+    printf("ContextStrings\r\n");
+    printf("%10s %12s %12s\r\n", "context", "ns/String", "ns/Pop");
+
+    for (int arena = 0; arena <= 1; arena++) {
+
+        double allocation = 0, pop = 0;
+
+        for (int r = 0; r < rounds; r++) {
+
+            double start = __benchNow();
+            if (arena)
+                memoryM()->PushArenaContext();
+            else
+                memoryM()->PushContext();
+
+            for (int i = 0; i < n; i++) {
+                memoryM()->NewString("Hello World");
+            }
+            double middle = __benchNow();
+            memoryM()->PopContext();
+            double end    = __benchNow();
+
+            allocation += middle - start;
+            pop        += end - middle;
+        }
+        printf("%10s %12.1f %12.1f\r\n", arena ? "arena" : "registry", allocation / (n * rounds), pop / rounds);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchContextPop
+///
+/// Latency of PopContext() for a context of 100 allocations while n allocations
+/// are alive in the outer context, half of them freed so the registry has
+/// available entries below the context. Also count the allocations of the
+/// context still alive after the Pop.
+void __benchContextPop() {
+
+    int liveCounts[] = { 1000, 10000, 100000 };
+    int inner        = 100;
+    int rounds       = 100;
+
+    printf("ContextPop\r\n");
+    printf("%10s %12s %12s\r\n", "live", "ns/Pop", "leaked/Pop");
+
+    for (int c = 0; c < (int)(sizeof(liveCounts) / sizeof(liveCounts[0])); c++) {
+
+        int n      = liveCounts[c];
+        int** ints = (int**)malloc(n * sizeof(int*));
+
+        memoryM()->PushContext();
+        for (int i = 0; i < n; i++) {
+            ints[i] = memoryM()->NewInt();
+        }
+        for (int i = 0; i < n; i += 2) {
+            memoryM()->Free(ints[i]);
+        }
+
+        double elapsed = 0;
+        int liveBefore = memoryM()->GetLiveCount();
+        for (int r = 0; r < rounds; r++) {
+
+            memoryM()->PushContext();
+            for (int i = 0; i < inner; i++) {
+                memoryM()->NewString("Hello World");
+            }
+            double start = __benchNow();
+            memoryM()->PopContext();
+            elapsed += __benchNow() - start;
+        }
+        int leaked = memoryM()->GetLiveCount() - liveBefore;
+        memoryM()->PopContext();
+
+        printf("%10d %12.1f %12.1f\r\n", n, elapsed / rounds, (double)leaked / rounds);
+        free(ints);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchSmallObjects
+///
+/// Throughput and heap used by n small allocations, plain malloc() versus
+/// MemoryM. The heap used is only measured with glibc.
+void __benchSmallObjects() {
+
+    int n          = 100000;
+    int sizes[]    = { 1, 4, 16, 64 };
+    void** objects = (void**)malloc(n * sizeof(void*));
+
+    printf("SmallObjects\r\n");
+    printf("%6s %10s %12s %12s %14s\r\n", "size", "allocator", "ns/New", "ns/Free", "heap byte/obj");
+
+    for (int c = 0; c < (int)(sizeof(sizes) / sizeof(sizes[0])); c++) {
+
+        int size = sizes[c];
+
+        double heap  = BENCH_HEAP_USED();
+        double start = __benchNow();
+        for (int i = 0; i < n; i++) {
+            objects[i] = malloc(size);
+            memset(objects[i], 0, size);
+        }
+        double middle = __benchNow();
+        double used   = BENCH_HEAP_USED() - heap;
+        for (int i = 0; i < n; i++) {
+            free(objects[i]);
+        }
+        double end = __benchNow();
+        printf("%6d %10s %12.1f %12.1f %14.1f\r\n", size, "malloc", (middle - start) / n, (end - middle) / n, used / n);
+
+        memoryM()->PushContext();
+        heap  = BENCH_HEAP_USED();
+        start = __benchNow();
+        for (int i = 0; i < n; i++) {
+            objects[i] = memoryM()->NewStringLen(size - 1);
+        }
+        middle = __benchNow();
+        used   = BENCH_HEAP_USED() - heap;
+        for (int i = 0; i < n; i++) {
+            memoryM()->Free(objects[i]);
+        }
+        end = __benchNow();
+        memoryM()->PopContext();
+        printf("%6d %10s %12.1f %12.1f %14.1f\r\n", size, "MemoryM", (middle - start) / n, (end - middle) / n, used / n);
+    }
+    free(objects);
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchBatch
+///
+/// Throughput of n allocations of 16 byte created and freed one by one, with
+/// FreeMultiple() by 8, and with NewMany() and FreeArray()
+void __benchBatch() {
+
+    int counts[]   = { 1000, 100000 };
+    int rounds     = 10;
+
+    printf("Batch\r\n");
+    printf("%10s %12s %12s %12s %12s %12s\r\n", "n", "ns/New", "ns/Free", "ns/Multiple", "ns/NewMany", "ns/FreeArray");
+
+    for (int c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); c++) {
+
+        int n          = counts[c];
+        void** objects = (void**)malloc(n * sizeof(void*));
+        int* sizes     = (int*)malloc(n * sizeof(int));
+        for (int i = 0; i < n; i++) {
+            sizes[i] = 16;
+        }
+        double elapsed[5] = { 0, 0, 0, 0, 0 };
+
+        for (int r = 0; r < rounds; r++) {
+
+            // Each round starts from an empty registry, so it grows with the batch
+            memoryM()->PushContext();
+            double start = __benchNow();
+            for (int i = 0; i < n; i++) {
+                objects[i] = memoryM()->NewStringLen(15);
+            }
+            double middle = __benchNow();
+            for (int i = 0; i < n; i++) {
+                memoryM()->Free(objects[i]);
+            }
+            elapsed[0] += middle - start;
+            elapsed[1] += __benchNow() - middle;
+            memoryM()->PopContext();
+
+            memoryM()->PushContext();
+            for (int i = 0; i < n; i++) {
+                objects[i] = memoryM()->NewStringLen(15);
+            }
+            start = __benchNow();
+            for (int i = 0; i + 8 <= n; i += 8) {
+                void** o = objects + i;
+                memoryM()->FreeMultiple(8, o[0], o[1], o[2], o[3], o[4], o[5], o[6], o[7]);
+            }
+            elapsed[2] += __benchNow() - start;
+            memoryM()->PopContext();
+
+            memoryM()->PushContext();
+            start = __benchNow();
+            memoryM()->NewMany(sizes, n, objects);
+            middle = __benchNow();
+            memoryM()->FreeArray(objects, n);
+            elapsed[3] += middle - start;
+            elapsed[4] += __benchNow() - middle;
+            memoryM()->PopContext();
+        }
+        double total = (double)n * rounds;
+        printf("%10d %12.1f %12.1f %12.1f %12.1f %12.1f\r\n", n, 
+            elapsed[0] / total, elapsed[1] / total, elapsed[2] / total, elapsed[3] / total, elapsed[4] / total);
+        free(objects);
+        free(sizes);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchZeroing
+///
+/// Latency and byte of memory touched per call, measured with the page faults,
+/// of NewStringLen() of 1MB never written, of NewString() copying 4KB, and of 
+/// NewStringLenUninit() of 1MB fully written
+void __benchZeroing() {
+
+    int size      = 1024 * 1024;
+    char* source  = (char*)malloc(4096);
+    char** blocks = (char**)malloc(1000 * sizeof(char*));
+    memset(source, 'a', 4095);
+    source[4095]  = '\0';
+
+    const char* methods[] = { "NewStringLen 1MB", "NewString 4KB", "Uninit 1MB written" };
+
+    printf("Zeroing\r\n");
+    printf("%20s %12s %16s\r\n", "method", "ns/call", "KB touched/call");
+
+    for (int m = 0; m < 3; m++) {
+
+        int n = m == 1 ? 1000 : 100;
+
+        memoryM()->PushContext();
+        double touched = BENCH_TOUCHED();
+        double start   = __benchNow();
+        for (int i = 0; i < n; i++) {
+            if (m == 0) {
+                blocks[i] = memoryM()->NewStringLen(size);
+            }
+            else if (m == 1) {
+                blocks[i] = memoryM()->NewString(source);
+            }
+            else {
+                blocks[i] = memoryM()->NewStringLenUninit(size);
+                memset(blocks[i], 'a', size);
+            }
+        }
+        double elapsed = __benchNow() - start;
+        touched        = BENCH_TOUCHED() - touched;
+        memoryM()->PopContext();
+        printf("%20s %12.1f %16.1f\r\n", methods[m], elapsed / n, touched / n / 1024);
+    }
+    free(blocks);
+    free(source);
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchShortStrings
+///
+/// Latency of the operations on strings under 24 byte: NewString() followed 
+/// by Free(), ReNewString() of a counter like a label redrawn each frame, and 
+/// StringConcat() of 4 pieces
+void __benchShortStrings() {
+
+    int n         = 1000000;
+    const char* texts[] = { "7", "42", "1337", "99999", "123456", "1234567" };
+
+    printf("ShortStrings\r\n");
+    printf("%16s %12s\r\n", "method", "ns/call");
+
+    double start = __benchNow();
+    for (int i = 0; i < n; i++) {
+        memoryM()->Free(memoryM()->NewString(texts[i % 6]));
+    }
+    printf("%16s %12.1f\r\n", "NewString+Free", (__benchNow() - start) / n);
+
+    char* s = memoryM()->NewString("");
+    start   = __benchNow();
+    for (int i = 0; i < n; i++) {
+        s = memoryM()->ReNewString(texts[i % 6], s);
+    }
+    printf("%16s %12.1f\r\n", "ReNewString", (__benchNow() - start) / n);
+    memoryM()->Free(s);
+
+    start = __benchNow();
+    for (int i = 0; i < n / 4; i++) {
+        s = memoryM()->NewString("ab");
+        s = memoryM()->StringConcat("cd", s);
+        s = memoryM()->StringConcat("efgh", s);
+        s = memoryM()->StringConcat("ijklmnop", s);
+        memoryM()->Free(s);
+    }
+    printf("%16s %12.1f\r\n", "StringConcat", (__benchNow() - start) / n);
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchIntern
+///
+/// n strings kept alive, taken from 300 distinct strings, allocated with 
+/// NewString() and with InternString(). Latency of the allocation and of the 
+/// Free() and the memory used
+void __benchIntern() {
+
+    int n            = 100000;
+    int distinct     = 300;
+    char** sources   = (char**)malloc(distinct * sizeof(char*));
+    char** strings   = (char**)malloc(n * sizeof(char*));
+    const char* methods[]  = { "NewString", "InternString" };
+
+    for (int i = 0; i < distinct; i++) {
+        sources[i] = (char*)malloc(64);
+        snprintf(sources[i], 64, "config.section%d.key%d", i % 17, i);
+    }
+
+    printf("Intern\r\n");
+    printf("%14s %12s %12s %14s\r\n", "method", "ns/New", "ns/Free", "byte used");
+
+    for (int m = 0; m < 2; m++) {
+
+        memoryM()->PushContext();
+        double start = __benchNow();
+        for (int i = 0; i < n; i++) {
+            strings[i] = m == 0 ? memoryM()->NewString(sources[i % distinct]) : memoryM()->InternString(sources[i % distinct]);
+        }
+        double middle = __benchNow();
+        int used      = memoryM()->GetMemoryUsed();
+        for (int i = 0; i < n; i++) {
+            memoryM()->Free(strings[i]);
+        }
+        double end = __benchNow();
+        memoryM()->PopContext();
+        printf("%14s %12.1f %12.1f %14d\r\n", methods[m], (middle - start) / n, (end - middle) / n, used);
+    }
+    for (int i = 0; i < distinct; i++) {
+        free(sources[i]);
+    }
+    free(sources);
+    free(strings);
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchSites
+///
+/// Latency of NewString() followed by Free(), called directly and through
+/// MM_NEW_STRING(). Build with -DMEMORYM_SITE_STATS to measure the cost of the
+/// counters of the call site, else both lines measure the same call
+void __benchSites() {
+
+    int n = 1000000;
+
+    #if defined(MEMORYM_SITE_STATS)
+        printf("Sites (MEMORYM_SITE_STATS)\r\n");
+    #else
+        printf("Sites\r\n");
+    #endif
+    printf("%16s %12s\r\n", "method", "ns/call");
+
+    double start = __benchNow();
+    for (int i = 0; i < n; i++) {
+        memoryM()->Free(memoryM()->NewString("Hello World"));
+    }
+    printf("%16s %12.1f\r\n", "NewString", (__benchNow() - start) / n);
+
+    start = __benchNow();
+    for (int i = 0; i < n; i++) {
+        memoryM()->Free(MM_NEW_STRING("Hello World"));
+    }
+    printf("%16s %12.1f\r\n", "MM_NEW_STRING", (__benchNow() - start) / n);
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchSampling
+///
+/// Latency of NewString() of 64 byte followed by Free() for several sample rates.
+/// Build with -DMEMORYM_HEAP_PROFILE to measure the sampling, 1GB only counts down
+void __benchSampling() {
+
+    int n       = 1000000;
+    int rates[] = { 1 << 30, 512 * 1024, 4096 };
+    char s[64];
+
+    memset(s, 'a', sizeof(s) - 1);
+    s[sizeof(s) - 1] = '\0';
+    #if defined(MEMORYM_HEAP_PROFILE)
+        printf("Sampling (MEMORYM_HEAP_PROFILE)\r\n");
+    #else
+        printf("Sampling\r\n");
+    #endif
+    printf("%12s %12s\r\n", "rate", "ns/call");
+
+    for (int r = 0; r < 3; r++) {
+
+        int previous = memoryM()->SetSampleRate(rates[r]);
+        double start = __benchNow();
+        for (int i = 0; i < n; i++) {
+            memoryM()->Free(memoryM()->NewString(s));
+        }
+        printf("%12d %12.1f\r\n", rates[r], (__benchNow() - start) / n);
+        memoryM()->SetSampleRate(previous);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchStats
+///
+/// Latency of GetStats() for 1k, 10k and 100k live allocations, it must not 
+/// depend on the count, and of NewInt() followed by Free(). Build with 
+/// -DMEMORYM_TIMELINE_SIZE=256 to measure the cost of the timeline
+void __benchStats() {
+
+    int sizes[]   = { 1000, 10000, 100000 };
+    int calls     = 100000;
+    static MemoryStats stats;
+
+    #if MEMORYM_TIMELINE_SIZE > 0
+        printf("Stats (MEMORYM_TIMELINE_SIZE %d)\r\n", MEMORYM_TIMELINE_SIZE);
+    #else
+        printf("Stats\r\n");
+    #endif
+    printf("%10s %14s %14s\r\n", "live", "ns/GetStats", "ns/New+Free");
+
+    for (int s = 0; s < 3; s++) {
+
+        memoryM()->PushContext();
+        for (int i = 0; i < sizes[s]; i++) {
+            memoryM()->NewInt();
+        }
+        double start = __benchNow();
+        for (int i = 0; i < calls; i++) {
+            memoryM()->GetStats(&stats);
+        }
+        double middle = __benchNow();
+        for (int i = 0; i < calls; i++) {
+            memoryM()->Free(memoryM()->NewInt());
+        }
+        double end = __benchNow();
+        memoryM()->PopContext();
+        printf("%10d %14.1f %14.1f\r\n", sizes[s], (middle - start) / calls, (end - middle) / calls);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchDate
+///
+/// Latency of NewDate() followed by Free(), and of ReNewDate() on the same date
+/// like a tick handler. Same for FormatDateTime() and ReFormatDateTime() of a clock,
+/// with the same date and with a new second each call
+void __benchDate() {
+
+    int n = 1000000;
+
+    printf("Date\r\n");
+    printf("%16s %12s\r\n", "method", "ns/call");
+
+    double start = __benchNow();
+    for (int i = 0; i < n; i++) {
+        memoryM()->Free(memoryM()->NewDate());
+    }
+    printf("%16s %12.1f\r\n", "NewDate+Free", (__benchNow() - start) / n);
+
+    struct tm * date = memoryM()->NewDate();
+    start = __benchNow();
+    for (int i = 0; i < n; i++) {
+        date = memoryM()->ReNewDate(date);
+    }
+    printf("%16s %12.1f\r\n", "ReNewDate", (__benchNow() - start) / n);
+
+    start = __benchNow();
+    for (int i = 0; i < n; i++) {
+        memoryM()->Free(memoryM()->FormatDateTime(date, "%H:%M:%S"));
+    }
+    printf("%16s %12.1f\r\n", "Format+Free", (__benchNow() - start) / n);
+
+    char* text = memoryM()->FormatDateTime(date, "%H:%M:%S");
+    start = __benchNow();
+    for (int i = 0; i < n; i++) {
+        text = memoryM()->ReFormatDateTime(date, "%H:%M:%S", text);
+    }
+    printf("%16s %12.1f\r\n", "ReFormat", (__benchNow() - start) / n);
+
+    start = __benchNow();
+    for (int i = 0; i < n; i++) {
+        date->tm_sec = i % 60; // A new text each call
+        text = memoryM()->ReFormatDateTime(date, "%H:%M:%S", text);
+    }
+    printf("%16s %12.1f\r\n", "ReFormat tick", (__benchNow() - start) / n);
+    memoryM()->Free(text);
+    memoryM()->Free(date);
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchFormat
+///
+/// Throughput of Format() for a short and a long format
+void __benchFormat() {
+
+    const char* formats[] = {
+        "[%s] %d",
+        "[%s] %d/%d/%d %X - The quick brown fox jumps over the lazy dog, the quick brown fox jumps over "
+        "the lazy dog, the quick brown fox jumps over the lazy dog: %s %u %b %c %d%% %s %x",
+    };
+    int n = 10000;
+
+    printf("Format\r\n");
+    printf("%10s %12s %12s\r\n", "length", "ns/Format", "MB/s");
+
+    for (int c = 0; c < (int)(sizeof(formats) / sizeof(formats[0])); c++) {
+
+        int length   = 0;
+        double start = __benchNow();
+        for (int i = 0; i < n; i++) {
+            char* s = memoryM()->Format(formats[c], "info", i, i, i, i, "Hello World", i, true, 'A', 100, "end", i);
+            length  = strlen(s);
+            memoryM()->Free(s);
+        }
+        double elapsed = __benchNow() - start;
+        printf("%10d %12.1f %12.1f\r\n", length, elapsed / n, (double)length * n / (elapsed / 1e9) / 1e6);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchBuilder
+///
+/// Build a string from n pieces with StringConcat() and with a string builder
+void __benchBuilder() {
+
+    int counts[] = { 100, 1000, 10000 };
+
+    printf("Builder\r\n");
+    printf("%10s %14s %14s\r\n", "pieces", "ns/Concat", "ns/Append");
+
+    for (int c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); c++) {
+
+        int n = counts[c];
+
+        memoryM()->PushContext();
+        double start = __benchNow();
+        char* s      = memoryM()->NewString("");
+        for (int i = 0; i < n; i++) {
+            s = memoryM()->StringConcat("Hello World ", s);
+        }
+        double concat = __benchNow() - start;
+
+        start    = __benchNow();
+        char* sb = memoryM()->NewBuilder(0);
+        for (int i = 0; i < n; i++) {
+            sb = memoryM()->Append(sb, "Hello World ", 12);
+        }
+        sb = memoryM()->ToString(sb);
+        double append = __benchNow() - start;
+        memoryM()->PopContext();
+
+        printf("%10d %14.1f %14.1f\r\n", n, concat / n, append / n);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchReport
+///
+/// Time to produce the report of n live allocations with GetReport() and 
+/// with WriteReport() to /dev/null
+void __benchReport() {
+
+    int liveCounts[] = { 1000, 10000, 100000 };
+
+    printf("Report\r\n");
+    printf("%10s %12s %12s %12s\r\n", "live", "GetReport ms", "text ms", "json ms");
+
+    FILE* devNull         = fopen("/dev/null", "w");
+    MemoryReportSink sink = MemoryReportSink_File(devNull);
+
+    for (int c = 0; c < (int)(sizeof(liveCounts) / sizeof(liveCounts[0])); c++) {
+
+        int n = liveCounts[c];
+
+        memoryM()->PushContext();
+        for (int i = 0; i < n; i++) {
+            memoryM()->NewInt();
+        }
+
+        double start = __benchNow();
+        memoryM()->Free(memoryM()->GetReport());
+        double getReport = __benchNow() - start;
+
+        start = __benchNow();
+        memoryM()->WriteReport(&sink, MEMORYM_REPORT_TEXT);
+        double text = __benchNow() - start;
+
+        start = __benchNow();
+        memoryM()->WriteReport(&sink, MEMORYM_REPORT_JSON);
+        double json = __benchNow() - start;
+        memoryM()->PopContext();
+
+        printf("%10d %12.2f %12.2f %12.2f\r\n", n, getReport / 1e6, text / 1e6, json / 1e6);
+    }
+    fclose(devNull);
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchRadixSort
+///
+/// Sort a darray of n pointers to random ints, positive and negative, with 
+/// qsort() and with darray_radix_sort(), then the same pointers by address. 
+/// Both orders are checked against qsort()
+int __benchCompareInt(const void* a, const void* b) {
+
+    int x = **(int**)a;
+    int y = **(int**)b;
+    return (x > y) - (x < y);
+}
+int __benchComparePointer(const void* a, const void* b) {
+
+    size_t x = (size_t)*(void**)a;
+    size_t y = (size_t)*(void**)b;
+    return (x > y) - (x < y);
+}
+void __benchRadixSort() {
+
+    int counts[] = { 10000, 1000000 };
+
+    printf("RadixSort\r\n");
+    printf("%10s %10s %12s %12s\r\n", "key", "elements", "qsort ms", "radix ms");
+
+    for (int c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); c++) {
+
+        int    n        = counts[c];
+        int*   ints     = (int*)malloc(n * sizeof(int));
+        void** shuffled = (void**)malloc(n * sizeof(void*));
+        void** expected = (void**)malloc(n * sizeof(void*));
+        DArray* array   = darray_init();
+        darray_resize(array, n);
+
+        unsigned int seed = 12345;
+        for (int i = 0; i < n; i++) {
+            seed        = seed * 1103515245 + 12345;
+            ints[i]     = (int)seed;
+            shuffled[i] = &ints[i];
+        }
+        for (int i = n - 1; i > 0; i--) { // The pointers out of the address order
+            seed        = seed * 1103515245 + 12345;
+            int j       = (seed >> 8) % (i + 1);
+            void* t     = shuffled[i];
+            shuffled[i] = shuffled[j];
+            shuffled[j] = t;
+        }
+
+        const char* keys[] = { "int", "pointer" };
+        for (int k = 0; k < 2; k++) {
+
+            memcpy(expected, shuffled, n * sizeof(void*));
+            double start = __benchNow();
+            qsort(expected, n, sizeof(void*), k == 0 ? __benchCompareInt : __benchComparePointer);
+            double sortQ = __benchNow() - start;
+
+            memcpy(array->data, shuffled, n * sizeof(void*));
+            array->last = n - 1;
+            start = __benchNow();
+            if (k == 0)
+                darray_radix_sort(array);
+            else
+                darray_radix_sort_by(array, NULL);
+            double sortR = __benchNow() - start;
+
+            for (int i = 0; i < n; i++) {
+                if (k == 0 ? *(int*)array->data[i] != *(int*)expected[i] : array->data[i] != expected[i]) {
+                    printf("%10s order differs from qsort at %d\r\n", keys[k], i);
+                    break;
+                }
+            }
+            printf("%10s %10d %12.2f %12.2f\r\n", keys[k], n, sortQ / 1e6, sortR / 1e6);
+        }
+
+        free(array->data); // The elements point in ints, not freed by darray_free()
+        free(array);
+        free(expected);
+        free(shuffled);
+        free(ints);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchThreads
+///
+/// Throughput of n threads allocating and freeing small strings. Local: each 
+/// thread frees its own strings. Remote: each thread frees the strings of its
+/// neighbour. Without MEMORYM_THREAD_LOCAL or MEMORYM_SHARED every call takes
+/// a global mutex.
+#if defined(MEMORYM_THREAD_LOCAL) || defined(MEMORYM_SHARED)
+    #define BENCH_LOCK()
+    #define BENCH_UNLOCK()
+#else
+    std::mutex __benchMemoryMutex;
+    #define BENCH_LOCK() __benchMemoryMutex.lock()
+    #define BENCH_UNLOCK() __benchMemoryMutex.unlock()
+#endif
+
+#define BENCH_THREADS_BATCH 256
+#define BENCH_THREADS_MAX 64
+
+typedef struct {
+
+    std::mutex              mutex;
+    std::condition_variable condition;
+    int                     count;
+    int                     generation;
+} BenchBarrier;
+
+void __benchBarrierWait(BenchBarrier* barrier, int threads) {
+
+    std::unique_lock<std::mutex> lock(barrier->mutex);
+    int generation = barrier->generation;
+    if (++barrier->count == threads) {
+        barrier->count = 0;
+        barrier->generation++;
+        barrier->condition.notify_all();
+    }
+    else {
+        barrier->condition.wait(lock, [&] { return generation != barrier->generation; });
+    }
+}
+
+BenchBarrier __benchThreadsBarrier;
+char*        __benchThreadsStrings[BENCH_THREADS_MAX][BENCH_THREADS_BATCH];
+
+void __benchThreadsWorker(int id, int threads, int rounds, bool remote) {
+
+    for (int r = 0; r < rounds; r++) {
+
+        for (int i = 0; i < BENCH_THREADS_BATCH; i++) {
+            BENCH_LOCK();
+            __benchThreadsStrings[id][i] = memoryM()->NewString("Hello World");
+            BENCH_UNLOCK();
+        }
+        if (remote)
+            __benchBarrierWait(&__benchThreadsBarrier, threads);
+
+        int owner = remote ? (id + 1) % threads : id;
+        for (int i = 0; i < BENCH_THREADS_BATCH; i++) {
+            BENCH_LOCK();
+            memoryM()->Free(__benchThreadsStrings[owner][i]);
+            BENCH_UNLOCK();
+        }
+        if (remote)
+            __benchBarrierWait(&__benchThreadsBarrier, threads);
+    }
+    #if defined(MEMORYM_THREAD_LOCAL)
+        __benchBarrierWait(&__benchThreadsBarrier, threads); // Nothing is freed remotely anymore
+        memoryM()->FreeAll();
+    #endif
+}
+
+void __benchThreads() {
+
+    int threadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    int pairs          = 1 << 20; // New/Free pairs per measure, shared by the threads
+
+    #if defined(MEMORYM_THREAD_LOCAL)
+        printf("Threads (thread local)\r\n");
+    #elif defined(MEMORYM_SHARED)
+        printf("Threads (%d shards)\r\n", MEMORYM_SHARD_COUNT);
+    #else
+        printf("Threads (global mutex)\r\n");
+    #endif
+    printf("%10s %14s %14s\r\n", "threads", "local Mpair/s", "remote Mpair/s");
+    memoryM(); // Initialized before the threads are started
+
+    for (int c = 0; c < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); c++) {
+
+        int threads = threadCounts[c];
+        int rounds  = pairs / BENCH_THREADS_BATCH / threads;
+        double throughput[2];
+
+        for (int remote = 0; remote <= 1; remote++) {
+
+            std::thread workers[BENCH_THREADS_MAX];
+            double start = __benchNow();
+            for (int t = 0; t < threads; t++) {
+                workers[t] = std::thread(__benchThreadsWorker, t, threads, rounds, remote == 1);
+            }
+            for (int t = 0; t < threads; t++) {
+                workers[t].join();
+            }
+            double elapsed = __benchNow() - start;
+            throughput[remote] = (double)rounds * BENCH_THREADS_BATCH * threads / (elapsed / 1e3);
+        }
+        printf("%10d %14.2f %14.2f\r\n", threads, throughput[0], throughput[1]);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+/// __benchSuite
+///
+/// ns/op and malloc() calls/op of the methods of MemoryManager and of workloads
+/// of an application: a tick handler, logging with Format(), random churn with 
+/// 1k, 100k and 1M live strings and nested contexts. The results are printed and
+/// written as JSON to the file given after the name of the benchmark, 
+/// memorym_suite.json by default, to compare 2 runs
+///
+///     ./memorym_benchmark Suite [file.json]
+
+#define BENCH_SUITE_MAX_RESULTS 64
+
+typedef struct {
+
+    const char* scenario;
+    const char* name;
+    int         param; // Live allocations or depth of the scenario, 0 when none
+    int         ops;
+    double      nsPerOp;
+    double      allocsPerOp; // Calls to malloc(), calloc() and realloc(), -1 when not counted
+} BenchResult;
+
+BenchResult __benchResults[BENCH_SUITE_MAX_RESULTS];
+int         __benchResultsCount;
+double      __benchSuiteStart;
+double      __benchSuiteMallocs;
+const char* __benchSuiteOutput = "memorym_suite.json";
+unsigned int __benchSuiteRandom = 1;
+
+const char* __benchSuiteConfig = "" // The MemoryM options of the build
+#if defined(MEMORYM_THREAD_LOCAL)
+    " MEMORYM_THREAD_LOCAL"
+#endif
+#if defined(MEMORYM_SHARED)
+    " MEMORYM_SHARED"
+#endif
+#if defined(MEMORYM_NO_SLAB)
+    " MEMORYM_NO_SLAB"
+#endif
+#if defined(MEMORYM_SITE_STATS)
+    " MEMORYM_SITE_STATS"
+#endif
+#if defined(MEMORYM_HEAP_PROFILE)
+    " MEMORYM_HEAP_PROFILE"
+#endif
+#if MEMORYM_TIMELINE_SIZE > 0
+    " MEMORYM_TIMELINE_SIZE"
+#endif
+;
+
+// Random number of 31 bit, the same sequence for each run
+int __benchSuiteNext() {
+
+    __benchSuiteRandom = __benchSuiteRandom * 1103515245u + 12345u;
+    return (int)(__benchSuiteRandom >> 1);
+}
+void __benchSuiteBegin() {
+
+    __benchSuiteMallocs = BENCH_MALLOCS();
+    __benchSuiteStart   = __benchNow();
+}
+void __benchSuiteEnd(const char* scenario, const char* name, int param, int ops) {
+
+    double elapsed = __benchNow() - __benchSuiteStart;
+    double mallocs = BENCH_MALLOCS() - __benchSuiteMallocs;
+
+    BenchResult* result = &__benchResults[__benchResultsCount++];
+    result->scenario    = scenario;
+    result->name        = name;
+    result->param       = param;
+    result->ops         = ops;
+    result->nsPerOp     = elapsed / ops;
+    result->allocsPerOp = BENCH_MALLOCS() < 0 ? -1 : mallocs / ops;
+    printf("%10s %24s %10d %12.1f %12.3f\r\n", scenario, name, param, result->nsPerOp, result->allocsPerOp);
+}
+//////////////////////////////////////////////////////////////////
+/// __benchSuiteApi
+///
+/// Each method n times in a context, the allocations of the method only
+void __benchSuiteApi() {
+
+    int n          = 100000;
+    char** strings = (char**)malloc(n * sizeof(char*));
+
+    memoryM()->PushContext();
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        memoryM()->NewBool();
+    }
+    __benchSuiteEnd("api", "NewBool", 0, n);
+    memoryM()->PopContext();
+
+    memoryM()->PushContext();
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        memoryM()->NewInt();
+    }
+    __benchSuiteEnd("api", "NewInt", 0, n);
+    memoryM()->PopContext();
+
+    memoryM()->PushContext();
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        strings[i] = memoryM()->NewString("Hello World");
+    }
+    __benchSuiteEnd("api", "NewString", 0, n);
+
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        strings[i] = memoryM()->StringConcat(" and the rest", strings[i]);
+    }
+    __benchSuiteEnd("api", "StringConcat", 0, n);
+
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        memoryM()->Free(strings[(i * 7919) % n]); // 7919 is prime, visit every string once
+    }
+    __benchSuiteEnd("api", "Free", 0, n);
+    memoryM()->PopContext();
+
+    memoryM()->PushContext();
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        memoryM()->Format("%s:%d %x", "value", i, i);
+    }
+    __benchSuiteEnd("api", "Format", 0, n);
+    memoryM()->PopContext();
+
+    memoryM()->PushContext();
+    struct tm * date = memoryM()->NewDate();
+    char * text      = memoryM()->FormatDateTime(date, "%H:%M:%S");
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        date->tm_sec = i % 60;
+        text = memoryM()->ReFormatDateTime(date, "%H:%M:%S", text);
+    }
+    __benchSuiteEnd("api", "ReFormatDateTime", 0, n);
+    memoryM()->PopContext();
+
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        memoryM()->PushContext();
+        memoryM()->NewInt();
+        memoryM()->PopContext();
+    }
+    __benchSuiteEnd("api", "PushContext-PopContext", 0, n);
+    free(strings);
+}
+//////////////////////////////////////////////////////////////////
+/// __benchSuiteScenarios
+///
+/// - tick: the tick handler of a watch face, a new date, the time and the 
+///   date formatted in place and a temporary text
+/// - logging: a log line formatted, completed and freed
+/// - churn: a random live string freed and replaced by a string of a random size
+/// - nested: contexts pushed to a depth with 2 strings each, then all popped
+void __benchSuiteScenarios() {
+
+    int n = 100000;
+
+    memoryM()->PushContext();
+    struct tm * date = memoryM()->NewDate();
+    char * time      = memoryM()->FormatDateTime(date, "%H:%M");
+    char * day       = memoryM()->FormatDateTime(date, "%a %d %b");
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        date = memoryM()->ReNewDate(date);
+        time = memoryM()->ReFormatDateTime(date, "%H:%M", time);
+        day  = memoryM()->ReFormatDateTime(date, "%a %d %b", day);
+        memoryM()->Free(memoryM()->Format("%d steps", i));
+    }
+    __benchSuiteEnd("tick", "TickHandler", 0, n);
+    memoryM()->PopContext();
+
+    const char* levels[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+    memoryM()->PushContext();
+    __benchSuiteBegin();
+    for (int i = 0; i < n; i++) {
+        char* line = memoryM()->Format("[%s] %s:%d request %x done in %dms", levels[i & 3], "network", i, i * 31, i % 500);
+        line       = memoryM()->StringConcat("\r\n", line);
+        memoryM()->Free(line);
+    }
+    __benchSuiteEnd("logging", "Format", 0, n);
+    memoryM()->PopContext();
+
+    int lives[]    = { 1000, 100000, 1000000 };
+    char** strings = (char**)malloc(lives[2] * sizeof(char*));
+    for (int l = 0; l < 3; l++) {
+
+        int live = lives[l];
+        memoryM()->PushContext();
+        for (int i = 0; i < live; i++) {
+            strings[i] = memoryM()->NewStringLen(__benchSuiteNext() % 64);
+        }
+        int ops = 1000000;
+        __benchSuiteBegin();
+        for (int i = 0; i < ops; i++) {
+            int k = __benchSuiteNext() % live;
+            memoryM()->Free(strings[k]);
+            strings[k] = memoryM()->NewStringLen(__benchSuiteNext() % 64);
+        }
+        __benchSuiteEnd("churn", "Free-NewStringLen", live, ops);
+        memoryM()->PopContext();
+    }
+    free(strings);
+
+    int depths[] = { 16, 256 };
+    for (int d = 0; d < 2; d++) {
+
+        int ops = n / depths[d];
+        __benchSuiteBegin();
+        for (int i = 0; i < ops; i++) {
+            for (int level = 0; level < depths[d]; level++) {
+                memoryM()->PushContext();
+                memoryM()->NewString("Hello");
+                memoryM()->NewStringLen(100);
+            }
+            for (int level = 0; level < depths[d]; level++) {
+                memoryM()->PopContext();
+            }
+        }
+        __benchSuiteEnd("nested", "PushContext-PopContext", depths[d], ops);
+    }
+}
+//////////////////////////////////////////////////////////////////
+/// __benchSuiteWrite
+///
+/// Write the results as JSON in __benchSuiteOutput
+void __benchSuiteWrite() {
+
+    FILE* file = fopen(__benchSuiteOutput, "w");
+    if (file == NULL) {
+        printf("Cannot write %s\r\n", __benchSuiteOutput);
+        return;
+    }
+    fprintf(file, "{\n  \"time\": %lld,\n  \"config\": \"%s\",\n  \"results\": [\n", (long long)time(NULL), __benchSuiteConfig);
+    for (int i = 0; i < __benchResultsCount; i++) {
+        BenchResult* result = &__benchResults[i];
+        fprintf(file, "    { \"scenario\": \"%s\", \"name\": \"%s\", \"param\": %d, \"ops\": %d, \"ns_per_op\": %.2f, \"allocs_per_op\": %.4f }%s\n",
+            result->scenario, result->name, result->param, result->ops, result->nsPerOp, result->allocsPerOp, 
+            i + 1 < __benchResultsCount ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    printf("Results written to %s\r\n", __benchSuiteOutput);
+}
+void __benchSuite() {
+
+    printf("Suite%s\r\n", __benchSuiteConfig);
+    printf("%10s %24s %10s %12s %12s\r\n", "scenario", "name", "param", "ns/op", "allocs/op");
+
+    memoryM()->PushContext(); // Grow the registry and the slabs once, like a running application
+    for (int i = 0; i < 100000; i++) {
+        memoryM()->NewInt();
+    }
+    memoryM()->PopContext();
+
+    __benchResultsCount = 0;
+    __benchCountMallocs = true;
+    __benchSuiteApi();
+    __benchSuiteScenarios();
+    __benchCountMallocs = false;
+    __benchSuiteWrite();
+}
+
+typedef struct {
+    const char* name;
+    void(*run)();
+} Benchmark;
+
+Benchmark __benchmarks[] = {
+    { "FreeLatency", __benchFreeLatency },
+    { "NewLatency" , __benchNewLatency  },
+    { "ContextStrings", __benchContextStrings },
+    { "ContextPop"  , __benchContextPop   },
+    { "SmallObjects", __benchSmallObjects },
+    { "Batch"       , __benchBatch        },
+    { "ShortStrings", __benchShortStrings },
+    { "Zeroing"     , __benchZeroing      },
+    { "Intern"      , __benchIntern       },
+    { "Sites"       , __benchSites        },
+    { "Sampling"    , __benchSampling     },
+    { "Stats"       , __benchStats        },
+    { "Date"        , __benchDate         },
+    { "Format"      , __benchFormat       },
+    { "Builder"     , __benchBuilder      },
+    { "Report"      , __benchReport       },
+    { "RadixSort"   , __benchRadixSort    },
+    { "Threads"     , __benchThreads      },
+    { "Suite"       , __benchSuite        },
+};
+
+int main(int argc, char* argv[]) {
+
+    int count = sizeof(__benchmarks) / sizeof(__benchmarks[0]);
+
+    if (argc > 2)
+        __benchSuiteOutput = argv[2];
+    for (int i = 0; i < count; i++) {
+        if (argc < 2 || !strcmp(argv[1], __benchmarks[i].name)) {
+            __benchmarks[i].run();
+        }
+    }
+    memoryM()->FreeAll();
+    return 0;
+}
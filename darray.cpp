@@ -93,47 +93,77 @@ void * darray_pop(DArray *array) {
 	return value;
 }
 
-DArray * darray_radix_sort(DArray *array) {
-
-	DArray *buckets, *bucket;
-	int *val, i, j, cur, mask, sortval, sorted;
-
-	buckets = darray_init();
+// The key of an element and the element, the scratch buffer holds 2 arrays of them
+typedef struct {
+	unsigned long long key;
+	void *value;
+} DArrayRadixEntry;
 
-	mask = 1;
+// The int pointed by value with the sign bit flipped, the negative ints first
+static unsigned long long darray_int_key(void *value) {
 
-	do {
-		sorted = 1;
+	return (unsigned int)*(int *)value ^ 0x80000000u;
+}
 
-		// reset the buckets
-		for (i = 0; i < 10; i++) {
-			darray_set(buckets, i, darray_init());
+DArray * darray_radix_sort_by(DArray *array, darray_key key) {
+
+	int count = array->last + 1;
+	if (count < 2)
+		return array;
+
+	DArrayRadixEntry *scratch = (DArrayRadixEntry *)malloc(2 * (size_t)count * sizeof(DArrayRadixEntry));
+	if (scratch == NULL)
+		return NULL;
+
+	DArrayRadixEntry *from = scratch;
+	DArrayRadixEntry *to   = scratch + count;
+	int histograms[8][256];
+
+	// Extract the keys once and count the 8 bytes of each key in the same loop
+	memset(histograms, 0, sizeof(histograms));
+	for (int i = 0; i < count; i++) {
+		void *value          = array->data[i];
+		unsigned long long k = key != NULL ? key(value) : (unsigned long long)(size_t)value;
+		from[i].key          = k;
+		from[i].value        = value;
+		for (int b = 0; b < 8; b++) {
+			histograms[b][(k >> (b * 8)) & 0xFF]++;
 		}
+	}
 
-		// sort the values into buckets
-		for (i = 0; i <= (array->last); i++) {
-			val = (int*)darray_get(array, i);
-			sortval = (*val / mask) % 10;
-			if (sortval > 0) { sorted = 0; }
-			darray_push((PDArray)darray_get(buckets, sortval), val);
-		}
+	// One stable pass per byte, the least significant first
+	for (int b = 0; b < 8; b++) {
 
-		// rebuild array
-		cur = 0;
+		int *histogram = histograms[b];
+		int  shift     = b * 8;
 
-		for (i = 0; i < 10; i++) {
-			bucket = (PDArray)darray_get(buckets, i);
+		// A byte equal in all the keys does not change the order, the high bytes 
+		// of small keys are skipped
+		if (histogram[(from[0].key >> shift) & 0xFF] == count)
+			continue;
 
-			for (j = 0; j <= (bucket->last); j++) {
-				darray_set(array,
-					cur++,
-					darray_get(bucket, j));
-			}
+		int offset = 0;
+		for (int d = 0; d < 256; d++) {
+			int n        = histogram[d];
+			histogram[d] = offset;
+			offset      += n;
 		}
+		for (int i = 0; i < count; i++) {
+			to[histogram[(from[i].key >> shift) & 0xFF]++] = from[i];
+		}
+		DArrayRadixEntry *t = from;
+		from = to;
+		to   = t;
+	}
 
-		mask *= 10;
+	for (int i = 0; i < count; i++) {
+		array->data[i] = from[i].value;
+	}
+	free(scratch);
+	return array;
+}
 
-	} while (!sorted);
+DArray * darray_radix_sort(DArray *array) {
 
-	return array;
+	return darray_radix_sort_by(array, darray_int_key);
 }
@@ -23,6 +23,12 @@ void    darray_free(DArray *array);
 void    darray_set(DArray *array, int index, void *value);
 void    darray_push(DArray *array, void *value);
 void*   darray_pop(DArray *array);
-DArray* darray_radix_sort(DArray *array);
+
+// Key of an element for darray_radix_sort_by(), the elements are sorted by increasing key
+typedef unsigned long long (*darray_key)(void *value);
+
+// Stable byte-wise radix sort, return NULL if the scratch buffer is not available, array is then unchanged
+DArray* darray_radix_sort(DArray *array);                     // By the int pointed by each element
+DArray* darray_radix_sort_by(DArray *array, darray_key key);  // By key(element), by the pointers if key is NULL
 
 #endif
\ No newline at end of file
@@ -14,8 +14,12 @@
 #include<stdarg.h>
 
 
+static char __pool[64 * 1024 * 1024];
+
 int _tmain(int argc, _TCHAR* argv[])
 {
+    if (argc > 1) // Any argument runs the tests with MemoryM in a pool
+        memoryM_InitWithPool(__pool, sizeof(__pool));
     memoryM()->UnitTests();
     memoryM()->FreeAll();
 	return 0;
@@ -0,0 +1,192 @@
+/*
+	phash
+	Open addressing hash index from a pointer to an int for C.
+	Part of MemoryM, MIT License
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include "phash.h"
+
+static unsigned int phash_hash(void *key) {
+
+	// Finalizer of MurmurHash3, spread the low bits of the pointer
+	// which are always 0 because of the alignment
+	unsigned long long k = (unsigned long long)(size_t)key;
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	return (unsigned int)k;
+}
+
+static void phash_free_sized(void *p, size_t) {
+
+	free(p);
+}
+
+static void* (*phash_malloc)(size_t size)           = malloc;
+static void  (*phash_release)(void *p, size_t size) = phash_free_sized;
+
+void phash_set_allocator(void* (*alloc)(size_t size), void (*release)(void *p, size_t size)) {
+
+	phash_malloc  = alloc;
+	phash_release = release;
+}
+
+// Return 0 and keep the hash unchanged when the memory is not available
+static int phash_alloc(PHash *hash, int size) {
+
+	void **keys   = (void **)phash_malloc(size * sizeof(void *));
+	int  *values  = (int *)phash_malloc(size * sizeof(int));
+	if (keys == NULL || values == NULL) {
+		if (keys != NULL)
+			phash_release(keys, size * sizeof(void *));
+		if (values != NULL)
+			phash_release(values, size * sizeof(int));
+		return 0;
+	}
+	memset(keys, 0, size * sizeof(void *));
+	memset(values, 0, size * sizeof(int));
+	hash->size   = size;
+	hash->count  = 0;
+	hash->keys   = keys;
+	hash->values = values;
+	return 1;
+}
+
+static int phash_resize(PHash *hash, int size) {
+
+	void **keys   = hash->keys;
+	int  *values  = hash->values;
+	int   oldSize = hash->size;
+
+	if (!phash_alloc(hash, size))
+		return 0;
+
+	for (int i = 0; i < oldSize; i++) {
+		if (keys[i] != NULL) {
+			phash_put(hash, keys[i], values[i]);
+		}
+	}
+	phash_release(keys, oldSize * sizeof(void *));
+	phash_release(values, oldSize * sizeof(int));
+	return 1;
+}
+
+PHash * phash_init() {
+
+	PHash *hash = (PPHash)phash_malloc(sizeof(PHash));
+	if (hash == NULL)
+		return NULL;
+	if (!phash_alloc(hash, 16)) {
+		phash_release(hash, sizeof(PHash));
+		return NULL;
+	}
+	return hash;
+}
+
+void phash_free(PHash *hash) {
+
+	phash_release(hash->keys, hash->size * sizeof(void *));
+	phash_release(hash->values, hash->size * sizeof(int));
+	phash_release(hash, sizeof(PHash));
+}
+
+void phash_clear(PHash *hash) {
+
+	memset(hash->keys, 0, hash->size * sizeof(void *));
+	hash->count = 0;
+}
+
+int phash_reserve(PHash *hash, int count) {
+
+	int size = hash->size;
+	while (count * 2 > size) { // Same load factor as phash_put()
+		size *= 2;
+	}
+	if (size != hash->size) {
+		return phash_resize(hash, size);
+	}
+	return 1;
+}
+
+void phash_put(PHash *hash, void *key, int value) {
+
+	if (key == NULL) // NULL is the empty marker
+		return;
+
+	if ((hash->count + 1) * 2 > hash->size) { // Keep the load factor under 50%
+		phash_resize(hash, hash->size * 2);
+	}
+
+	int mask = hash->size - 1;
+	int i    = phash_hash(key) & mask;
+
+	while (hash->keys[i] != NULL) {
+		if (hash->keys[i] == key) { // Update
+			hash->values[i] = value;
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+	hash->keys[i]   = key;
+	hash->values[i] = value;
+	hash->count++;
+}
+
+int phash_get(PHash *hash, void *key) {
+
+	if (key == NULL)
+		return PHASH_NOT_FOUND;
+
+	int mask = hash->size - 1;
+	int i    = phash_hash(key) & mask;
+
+	while (hash->keys[i] != NULL) {
+		if (hash->keys[i] == key) {
+			return hash->values[i];
+		}
+		i = (i + 1) & mask;
+	}
+	return PHASH_NOT_FOUND;
+}
+
+int phash_remove(PHash *hash, void *key) {
+
+	if (key == NULL)
+		return PHASH_NOT_FOUND;
+
+	int mask = hash->size - 1;
+	int i    = phash_hash(key) & mask;
+
+	while (hash->keys[i] != key) {
+		if (hash->keys[i] == NULL) {
+			return PHASH_NOT_FOUND;
+		}
+		i = (i + 1) & mask;
+	}
+
+	int value = hash->values[i];
+	hash->count--;
+
+	// Backward shift: move back the following entries of the cluster
+	// that would not be reachable anymore because of the hole
+	int j = i;
+	while (true) {
+		j = (j + 1) & mask;
+		if (hash->keys[j] == NULL) {
+			break;
+		}
+		int home = phash_hash(hash->keys[j]) & mask;
+		// Can the entry at j be moved to the hole at i
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			hash->keys[i]   = hash->keys[j];
+			hash->values[i] = hash->values[j];
+			i = j;
+		}
+	}
+	hash->keys[i] = NULL;
+	return value;
+}
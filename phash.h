@@ -0,0 +1,32 @@
+/*
+phash - Open addressing hash index from a pointer to an int for C.
+Linear probing with backward shift deletion, no tombstone.
+Part of MemoryM, MIT License
+*/
+
+#ifndef _PHASH_H_
+#define _PHASH_H_
+
+#include <stddef.h>
+
+#define PHASH_NOT_FOUND -1
+
+typedef struct {
+	void **keys;
+	int  *values;
+	int   count;
+	int   size; // Always a power of 2
+} PHash;
+
+#define PPHash PHash*
+
+PHash*  phash_init();
+void    phash_free(PHash *hash);
+void    phash_clear(PHash *hash);
+int     phash_reserve(PHash *hash, int count); // Resize once to index count keys, 0 if the memory is not available
+void    phash_put(PHash *hash, void *key, int value);
+int     phash_get(PHash *hash, void *key);
+int     phash_remove(PHash *hash, void *key);
+void    phash_set_allocator(void* (*alloc)(size_t size), void (*release)(void *p, size_t size)); // malloc() and free() by default, release gets the size allocated
+
+#endif